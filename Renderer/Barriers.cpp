@@ -0,0 +1,129 @@
+#include "Barriers.h"
+
+namespace renderer::barriers {
+    namespace {
+        constexpr VkAccessFlags2 write_accesses = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+                                                  VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+                                                  VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                                  VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+                                                  VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+        struct AccessInfo {
+            VkImageLayout layout;
+            VkPipelineStageFlags2 stages;
+            VkAccessFlags2 access;
+        };
+
+        AccessInfo access_info(ImageAccess access) {
+            switch (access) {
+                case ImageAccess::CopyDst:
+                    return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+                case ImageAccess::BlitSrc:
+                    return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+                case ImageAccess::BlitDst:
+                    return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT};
+                case ImageAccess::ComputeSampled:
+                    return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+                case ImageAccess::ComputeStorageWrite:
+                    return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT};
+                case ImageAccess::FragmentSampled:
+                    return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT};
+                case ImageAccess::ColorAttachment:
+                    return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT};
+                case ImageAccess::CopySrc:
+                    return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT};
+                case ImageAccess::Present:
+                    return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+                case ImageAccess::Undefined:
+                default:
+                    return {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+            }
+        }
+
+        // reads in the same layout that an earlier barrier already made the data visible to
+        bool already_visible(const SubresourceState &state, const AccessInfo &next) {
+            return state.layout == next.layout && state.write_access == VK_ACCESS_2_NONE &&
+                   (next.access & write_accesses) == 0 &&
+                   (next.stages & ~state.read_stages) == 0 && (next.access & ~state.read_access) == 0;
+        }
+
+        SubresourceState after(const SubresourceState &state, const AccessInfo &next) {
+            if (next.access & write_accesses)
+                return {next.layout, next.stages, next.access, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE};
+            // the barrier made the writes visible to next, earlier readers in the same layout keep their visibility
+            if (state.layout == next.layout)
+                return {next.layout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+                        state.read_stages | next.stages, state.read_access | next.access};
+            return {next.layout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, next.stages, next.access};
+        }
+
+        BarrierStats totals = {};
+    }
+
+    void BarrierBatch::add(const VkImageMemoryBarrier2 &barrier) {
+        images.push_back(barrier);
+    }
+
+    void BarrierBatch::add(const VkBufferMemoryBarrier2 &barrier) {
+        buffers.push_back(barrier);
+    }
+
+    void BarrierBatch::transition(VkImage image, SubresourceState *states, uint32_t base_level, uint32_t count,
+                                  ImageAccess access, uint32_t layers) {
+        const AccessInfo next = access_info(access);
+        for (uint32_t i = 0; i < count;) {
+            const SubresourceState state = states[i];
+            if (already_visible(state, next)) {
+                totals.elided++;
+                i++;
+                continue;
+            }
+            uint32_t end = i + 1;
+            while (end < count && states[end] == state)
+                end++;
+            // waits for earlier readers too when the layout changes or next writes, only writes need availability
+            images.push_back({
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                .srcStageMask = state.write_stages | state.read_stages,
+                .srcAccessMask = state.write_access,
+                .dstStageMask = next.stages,
+                .dstAccessMask = next.access,
+                .oldLayout = state.layout,
+                .newLayout = next.layout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = image,
+                .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, base_level + i, end - i, 0, layers},
+            });
+            const SubresourceState updated = after(state, next);
+            for (; i < end; i++)
+                states[i] = updated;
+        }
+    }
+
+    bool BarrierBatch::empty() const {
+        return images.empty() && buffers.empty();
+    }
+
+    void BarrierBatch::flush(VkCommandBuffer cb) {
+        if (empty())
+            return;
+        VkDependencyInfo dependency = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount = (uint32_t)buffers.size(),
+            .pBufferMemoryBarriers = buffers.data(),
+            .imageMemoryBarrierCount = (uint32_t)images.size(),
+            .pImageMemoryBarriers = images.data(),
+        };
+        vkCmdPipelineBarrier2KHR(cb, &dependency);
+        totals.barriers += images.size() + buffers.size();
+        totals.dependencies++;
+        images.clear();
+        buffers.clear();
+    }
+
+    BarrierStats stats() {
+        return totals;
+    }
+}
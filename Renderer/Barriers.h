@@ -0,0 +1,67 @@
+#ifndef BARRIERS_H
+#define BARRIERS_H
+#include <cstdint>
+#include <vector>
+#include <volk.h>
+
+/**
+ * Image state tracking and barrier batching. Tracked subresources remember their layout, the last write and
+ * the reads that already saw it, so a transition only waits on what actually happened before: source accesses
+ * are the pending writes, reads that are already visible need no barrier at all. Barriers are collected in a
+ * BarrierBatch and recorded as one vkCmdPipelineBarrier2KHR however many images they cover.
+ */
+namespace renderer::barriers {
+    /// what the next commands do with a subresource, the tracker derives layout, stages and accesses from it
+    enum class ImageAccess : uint8_t {
+        Undefined,              // contents are discarded
+        CopyDst,
+        BlitSrc,
+        BlitDst,
+        ComputeSampled,
+        ComputeStorageWrite,
+        FragmentSampled,
+        ColorAttachment,
+        CopySrc,
+        Present,                // handed to the presentation engine, which is synchronized by semaphores
+    };
+
+    struct SubresourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 write_stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 write_access = VK_ACCESS_2_NONE;   // not yet made available
+        VkPipelineStageFlags2 read_stages = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 read_access = VK_ACCESS_2_NONE;     // already visible to read_stages
+
+        bool operator==(const SubresourceState &) const = default;
+    };
+
+    class BarrierBatch {
+    public:
+        void add(const VkImageMemoryBarrier2 &barrier);
+        void add(const VkBufferMemoryBarrier2 &barrier);
+        /**
+         * appends the barriers that move states[0, count) to access, adjacent levels in the same state share one
+         * barrier, and updates the states
+         * @param states tracked state of each level from base_level on
+         * @param layers array layers, a level's layers share its state
+         */
+        void transition(VkImage image, SubresourceState *states, uint32_t base_level, uint32_t count, ImageAccess access,
+                        uint32_t layers = 1);
+        bool empty() const;
+        /// records everything added so far as one dependency, nothing when empty
+        void flush(VkCommandBuffer cb);
+
+    private:
+        std::vector<VkImageMemoryBarrier2> images;
+        std::vector<VkBufferMemoryBarrier2> buffers;
+    };
+
+    struct BarrierStats {
+        uint64_t barriers;      // image and buffer barriers recorded
+        uint64_t dependencies;  // vkCmdPipelineBarrier2KHR calls they went out in
+        uint64_t elided;        // level transitions that needed no barrier
+    };
+    /// totals since startup
+    BarrierStats stats();
+}
+#endif //BARRIERS_H
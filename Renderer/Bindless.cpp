@@ -0,0 +1,162 @@
+#include "Bindless.h"
+#include <algorithm>
+#include <vector>
+#include <SDL3/SDL_log.h>
+
+#include "Renderer.h"
+#include "ResourceManager.h"
+#include "renderer_constants.h"
+#include "../debug_panic.h"
+
+namespace renderer::bindless {
+    namespace {
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkDescriptorPool pool = VK_NULL_HANDLE;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkSampler linearSampler = VK_NULL_HANDLE;
+        uint32_t tableCapacity = 0;
+        uint32_t nextSlot = 0;          // slots below this were handed out at least once
+        uint32_t liveCount = 0;
+        std::vector<TextureHandle> freeSlots;
+
+        void check(VkResult err, const char *what) {
+            if (err == VK_SUCCESS)
+                return;
+            SDL_Log("[bindless] Error: %s failed with VkResult %d", what, err);
+            panic();
+        }
+    }
+
+    void init() {
+        VkPhysicalDeviceVulkan12Properties properties12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+        VkPhysicalDeviceProperties2 properties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &properties12};
+        vkGetPhysicalDeviceProperties2(g_PhysicalDevice, &properties);
+        tableCapacity = std::min({(uint32_t)BINDLESS_TEXTURE_CAPACITY,
+                                  properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                                  properties12.maxPerStageDescriptorUpdateAfterBindSampledImages});
+
+        VkSamplerCreateInfo sampler_info = {
+            .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+            .magFilter = VK_FILTER_LINEAR,
+            .minFilter = VK_FILTER_LINEAR,
+            .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+            .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            .maxLod = VK_LOD_CLAMP_NONE,
+        };
+        check(vkCreateSampler(device, &sampler_info, g_vk_Allocator, &linearSampler), "vkCreateSampler");
+
+        VkDescriptorSetLayoutBinding bindings[] = {
+            {0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, tableCapacity, VK_SHADER_STAGE_ALL, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_SAMPLER, 1, VK_SHADER_STAGE_ALL, &linearSampler},
+        };
+        // slots nobody registered stay unwritten, and writing one never touches the ones in flight
+        VkDescriptorBindingFlags binding_flags[] = {
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+            0,
+        };
+        VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+            .bindingCount = 2,
+            .pBindingFlags = binding_flags,
+        };
+        VkDescriptorSetLayoutCreateInfo set_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext = &flags_info,
+            .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+            .bindingCount = 2,
+            .pBindings = bindings,
+        };
+        check(vkCreateDescriptorSetLayout(device, &set_info, g_vk_Allocator, &setLayout), "vkCreateDescriptorSetLayout");
+
+        VkDescriptorPoolSize sizes[] = {
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, tableCapacity},
+            {VK_DESCRIPTOR_TYPE_SAMPLER, 1},
+        };
+        VkDescriptorPoolCreateInfo pool_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+            .maxSets = 1,
+            .poolSizeCount = 2,
+            .pPoolSizes = sizes,
+        };
+        check(vkCreateDescriptorPool(device, &pool_info, g_vk_Allocator, &pool), "vkCreateDescriptorPool");
+
+        VkDescriptorSetAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool = pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &setLayout,
+        };
+        check(vkAllocateDescriptorSets(device, &alloc_info, &descriptorSet), "vkAllocateDescriptorSets");
+        SDL_Log("[bindless] %u texture slots", tableCapacity);
+    }
+
+    void shutdown() {
+        vkDestroyDescriptorPool(device, pool, g_vk_Allocator);
+        vkDestroyDescriptorSetLayout(device, setLayout, g_vk_Allocator);
+        vkDestroySampler(device, linearSampler, g_vk_Allocator);
+        pool = VK_NULL_HANDLE;
+        setLayout = VK_NULL_HANDLE;
+        linearSampler = VK_NULL_HANDLE;
+        descriptorSet = VK_NULL_HANDLE;
+        freeSlots.clear();
+        nextSlot = 0;
+        liveCount = 0;
+    }
+
+    TextureHandle register_image(VkImageView view) {
+        TextureHandle handle;
+        if (!freeSlots.empty()) {
+            handle = freeSlots.back();
+            freeSlots.pop_back();
+        } else if (nextSlot < tableCapacity) {
+            handle = nextSlot++;
+        } else {
+            SDL_Log("[bindless] Warning: all %u texture slots are taken", tableCapacity);
+            return INVALID_TEXTURE_HANDLE;
+        }
+        VkDescriptorImageInfo image_info = {VK_NULL_HANDLE, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = descriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = handle,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            .pImageInfo = &image_info,
+        };
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        liveCount++;
+        return handle;
+    }
+
+    void release(TextureHandle handle) {
+        if (handle == INVALID_TEXTURE_HANDLE)
+            return;
+        liveCount--;
+        // the descriptor keeps pointing at the old view, partially bound lets it dangle as long as nothing samples it
+        deferffl([handle] {
+            if (pool != VK_NULL_HANDLE)
+                freeSlots.push_back(handle);
+        });
+    }
+
+    VkDescriptorSetLayout set_layout() {
+        return setLayout;
+    }
+
+    VkDescriptorSet set() {
+        return descriptorSet;
+    }
+
+    uint32_t capacity() {
+        return tableCapacity;
+    }
+
+    uint32_t used() {
+        return liveCount;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef BINDLESS_H
+#define BINDLESS_H
+#include <cstdint>
+#include <volk.h>
+
+/**
+ * Global texture table. One update-after-bind descriptor set holds a partially bound array of sampled images
+ * (binding 0) and an immutable linear clamp sampler (binding 1), shaders index the array with a 32 bit handle:
+ *
+ *     layout(set = 0, binding = 0) uniform texture2D textures[];
+ *     layout(set = 0, binding = 1) uniform sampler linear_sampler;
+ *
+ * Slots can be written while frames using the set are in flight, released slots are reused once the frames that
+ * may still sample them finished.
+ */
+namespace renderer::bindless {
+    using TextureHandle = uint32_t;
+    constexpr TextureHandle INVALID_TEXTURE_HANDLE = UINT32_MAX;
+
+    /// called by SetupVulkan once the device exists
+    void init();
+    /// device must be idle
+    void shutdown();
+
+    /**
+     * @param view sampled in SHADER_READ_ONLY_OPTIMAL, must stay alive until release
+     * @return INVALID_TEXTURE_HANDLE when the table is full
+     */
+    TextureHandle register_image(VkImageView view);
+    void release(TextureHandle handle);
+
+    VkDescriptorSetLayout set_layout();
+    VkDescriptorSet set();
+    /// BINDLESS_TEXTURE_CAPACITY clamped to the device's update-after-bind limits
+    uint32_t capacity();
+    uint32_t used();
+}
+#endif //BINDLESS_H
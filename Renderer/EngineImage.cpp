@@ -5,32 +5,83 @@
 #include "EngineImage.h"
 #include <volk.h>
 #include <bit>
+#include <SDL3/SDL_error.h>
+#include <SDL3/SDL_iostream.h>
+#include <SDL3/SDL_log.h>
 #include <stb_image.h>
 #include "../love_resource_locator.h"
 #include "../debug_panic.h"
 #include "Renderer.h"
+#include "Bindless.h"
 #include "ResourceManager.h"
+#include "GpuTimeline.h"
+#include "MipGenerator.h"
+#include "StagingRing.h"
+#include "Ktx2.h"
 #include <vk_mem_alloc.h>
-EngineImage* EngineImage::make(VkCommandBuffer cb, ResourceLocator image_source, VkImageUsageFlags usage,bool generate_mips) {
-    uint32_t width, height, channels;
+
+namespace {
+    // sampled with linear filtering and written by copies, plus blits when a chain is generated
+    bool supports_upload(VkFormat format, bool generate_mips) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(renderer::g_PhysicalDevice, format, &properties);
+        const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT |
+                                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & needed) == needed &&
+               (!generate_mips || renderer::mips::supports_blit(format));
+    }
+}
+
+EngineImage* EngineImage::make(ResourceLocator image_source, VkImageUsageFlags usage,bool generate_mips) {
+    // the file is read once, KTX2 levels are uploaded straight from it and anything else is decoded from memory
+    size_t size = 0;
+    auto* file = (uint8_t*)SDL_LoadFile(image_source.path,&size);
+    if (!file) {
+        SDL_Log("[image] Error: could not read %s: %s", image_source.path, SDL_GetError());
+        panic();
+    }
+    if (renderer::ktx2::is_ktx2(file,size)) {
+        PrebuiltImage source;
+        if (!renderer::ktx2::parse(file,size,image_source.path,source))
+            panic();
+        return make_prebuilt(source, usage, file, SDL_free);
+    }
+    int width, height, channels;
+    // in the file's own channel count, the staging copy widens what the image format can't hold as is
+    uint8_t* pixels = stbi_load_from_memory(file,(int)size,&width,&height,&channels,0);
+    SDL_free(file);
+    if (!pixels) {
+        SDL_Log("[image] Error: could not decode %s: %s", image_source.path, stbi_failure_reason());
+        panic();
+    }
+    return make_from_pixels(pixels, width, height, channels, usage, generate_mips, stbi_image_free);
+}
+
+EngineImage* EngineImage::make_from_pixels(uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels,
+                                           VkImageUsageFlags usage, bool generate_mips, void (*release)(void*)) {
     usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    stbi_info(image_source.path, (int*)&width, (int*)&height, (int*)&channels);
     auto* image=new EngineImage();
 
-
-    auto format   = channels==4?VK_FORMAT_R8G8B8A8_SRGB:
-                    channels==3?VK_FORMAT_R8G8B8_SRGB:
-                    channels==2?VK_FORMAT_R8G8_SRGB:
-                                VK_FORMAT_R8G8B8_SRGB;
-    uint32_t mipcount = generate_mips?std::bit_width(std::max(width,height)):1;
+    // gray and gray alpha stay one and two bytes where the device handles those formats, the view swizzles them
+    // back to gray. RGB is always widened, three byte formats are rarely sampleable
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+    VkComponentMapping components = {};
+    const VkFormat narrow = channels==1?VK_FORMAT_R8_SRGB:channels==2?VK_FORMAT_R8G8_SRGB:VK_FORMAT_UNDEFINED;
+    if (narrow != VK_FORMAT_UNDEFINED && supports_upload(narrow,generate_mips)) {
+        format = narrow;
+        components = {VK_COMPONENT_SWIZZLE_R,VK_COMPONENT_SWIZZLE_R,VK_COMPONENT_SWIZZLE_R,
+                      channels==2?VK_COMPONENT_SWIZZLE_G:VK_COMPONENT_SWIZZLE_ONE};
+    }
+    const uint32_t texel_size = format==VK_FORMAT_R8G8B8A8_SRGB?4:channels;
+    uint32_t mipcount = generate_mips?std::min<uint32_t>(std::bit_width(std::max(width,height)),MAX_IMAGE_MIPS):1;
+    if (mipcount > 1) usage |= renderer::mips::required_usage(format);
     image->width = width;
     image->height = height;
     image->format = format;
     image->mipcount = mipcount;
-    image->imageLayout.resize(mipcount);
-    std::fill(image->imageLayout.begin(), image->imageLayout.end(), VK_IMAGE_LAYOUT_UNDEFINED);
     VkImageCreateInfo info = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .flags = mipcount > 1 ? renderer::mips::required_flags(format) : 0,
         .imageType = VK_IMAGE_TYPE_2D,
         .format = format,
         .extent = {width,height,1},
@@ -49,60 +100,137 @@ EngineImage* EngineImage::make(VkCommandBuffer cb, ResourceLocator image_source,
     };
     vmaCreateImage(renderer::vma_allocator,&info,&vmaInfo,&image->deviceImage,&image->allocation,&image->alloc_info);
 
-    uint8_t* lmem = stbi_load(image_source.path, (int*)&width, (int*)&height, (int*)&channels,15);
-
-    VkBuffer local_tmp;
-    VmaAllocation local_tmp_alloc;
-    VmaAllocationInfo tmp_info;
-    vmaInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
-    vmaInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT|VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-    vmaInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
-    VkBufferCreateInfo buffer_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .flags = 0,
-        .size = width*height*channels,
-        .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VkImageViewUsageCreateInfo view_usage = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO,
+        .usage = renderer::mips::view_usage(format,usage),
+    };
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = &view_usage,
+        .image = image->deviceImage,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .components = components,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT,0,mipcount,0,1},
+    };
+    vkCreateImageView(renderer::device,&view_info,renderer::g_vk_Allocator,&image->imageView);
+    if (usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+        image->bindless = renderer::bindless::register_image(image->imageView);
+
+    // the staging ring takes ownership of pixels and releases them once the last chunk is copied out
+    // only level 0 goes through the transfer queue, the rest of the chain is filled on the graphics queue
+    image->transition(renderer::staging::upload_barriers(),renderer::barriers::ImageAccess::CopyDst,0,1);
+    renderer::staging::upload_image({
+        .image = image->deviceImage,
+        .width = width,
+        .height = height,
+        .texel_size = texel_size,
+        .source_channels = texel_size != channels ? channels : 0,
+        .pixels = pixels,
+        .release = release,
+    }, DeferredCallback([image]{ image->finish_upload(renderer::staging::acquire_cb(),image->mipcount > 1); }));
+
+    return image;
+}
+
+EngineImage* EngineImage::make_prebuilt(const PrebuiltImage& source, VkImageUsageFlags usage, void* owner,
+                                        void (*release)(void*)) {
+    usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    auto* image=new EngineImage();
+    image->width = source.width;
+    image->height = source.height;
+    image->format = source.format;
+    image->mipcount = source.mipcount;
+    image->layers = source.layers;
+    VkImageCreateInfo info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = source.format,
+        .extent = {source.width,source.height,1},
+        .mipLevels = source.mipcount,
+        .arrayLayers = source.layers,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 1,
         .pQueueFamilyIndices = &renderer::g_QueueFamily,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
-    vmaCreateBuffer(renderer::vma_allocator,&buffer_info,&vmaInfo,&local_tmp,&local_tmp_alloc,&tmp_info);
-    deferffl([local_tmp, local_tmp_alloc]{vmaDestroyBuffer(renderer::vma_allocator,local_tmp,local_tmp_alloc);});
-    memcpy(tmp_info.pMappedData,lmem,1/*8 bit srgb*/*width*height*channels);
-    vmaFlushAllocation(renderer::vma_allocator,local_tmp_alloc,tmp_info.offset,tmp_info.size);
-    stbi_image_free(lmem);
-    image->ChangeImageLayout(cb,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,VK_PIPELINE_STAGE_TRANSFER_BIT);
-    VkBufferImageCopy region = {
-        .bufferOffset = 0,
-        .bufferRowLength = width,
-        .bufferImageHeight = height,
-        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT,0,0,1},
-        .imageOffset = {0,0,0},
-        .imageExtent = {width,height,1},
+    VmaAllocationCreateInfo vmaInfo = {
+        .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+    };
+    vmaCreateImage(renderer::vma_allocator,&info,&vmaInfo,&image->deviceImage,&image->allocation,&image->alloc_info);
+
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = image->deviceImage,
+        .viewType = source.layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D,
+        .format = source.format,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT,0,source.mipcount,0,source.layers},
     };
-    vkCmdCopyBufferToImage(cb,local_tmp,image->deviceImage,VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,1, &region);
+    vkCreateImageView(renderer::device,&view_info,renderer::g_vk_Allocator,&image->imageView);
+    // the bindless table only holds 2D views
+    if (usage & VK_IMAGE_USAGE_SAMPLED_BIT && source.layers == 1)
+        image->bindless = renderer::bindless::register_image(image->imageView);
+
+    // one upload per level and layer, the queue records them in order so the last one releases owner. Recorded
+    // in the same frame they become regions of a single copy command
+    image->transition(renderer::staging::upload_barriers(),renderer::barriers::ImageAccess::CopyDst);
+    for (uint32_t mip = 0; mip < source.mipcount; mip++) {
+        const size_t layer_size = source.level_size(mip);
+        for (uint32_t layer = 0; layer < source.layers; layer++) {
+            const bool last = mip == source.mipcount-1 && layer == source.layers-1;
+            renderer::staging::ImageUpload upload = {
+                .image = image->deviceImage,
+                .width = std::max(source.width>>mip,1u),
+                .height = std::max(source.height>>mip,1u),
+                .texel_size = source.block_size,
+                .block_extent = source.block_extent,
+                .mip = mip,
+                .layer = layer,
+                .pixels = source.levels[mip] + layer*layer_size,
+                .release = last ? release : nullptr,
+                .owner = owner,
+            };
+            if (last)
+                renderer::staging::upload_image(upload, DeferredCallback([image]{ image->finish_upload(renderer::staging::acquire_cb(),false); }));
+            else
+                renderer::staging::upload_image(upload);
+        }
+    }
 
     return image;
 }
 
-void EngineImage::ChangeImageLayout(VkCommandBuffer cb, VkImageLayout newLayout, VkPipelineStageFlags srcstage,
-                                    VkPipelineStageFlags dststage, uint32_t mipstart, uint32_t mipcount) {
-    auto oldlayout = imageLayout[mipstart];
-    if (mipcount == (uint32_t)-1) mipcount = this->mipcount;
-    VkImageMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .srcAccessMask = VK_ACCESS_NONE,
-        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .oldLayout = oldlayout,
-        .newLayout = newLayout,
-        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-        .image = deviceImage,
-        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT,mipstart,mipcount,0,1},
-    };
-    vkCmdPipelineBarrier(cb,srcstage,dststage,0,0,nullptr,0,nullptr,1,&barrier);
-    for(uint32_t i=0;i<mipcount;i++) {
-        if (oldlayout!=imageLayout[mipstart + i]) panic();
-        imageLayout[mipstart + i] = newLayout;
-    }
-}
\ No newline at end of file
+void EngineImage::destroy() {
+    renderer::bindless::release(bindless);
+    bindless = renderer::bindless::INVALID_TEXTURE_HANDLE;
+    defer_destroy_image_view(imageView);
+    defer_destroy_image(deviceImage, allocation);
+    imageView = VK_NULL_HANDLE;
+    deviceImage = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+}
+
+void EngineImage::finish_upload(VkCommandBuffer cb, bool generate_mips) {
+    if (generate_mips)
+        renderer::mips::generate(cb,*this);
+    else // joins the other uploads finishing this frame in one barrier
+        transition(renderer::staging::acquire_barriers(),renderer::barriers::ImageAccess::FragmentSampled);
+    uploaded = true;
+    upload_value = renderer::timeline::pending_value();
+}
+
+void EngineImage::transition(renderer::barriers::BarrierBatch &batch, renderer::barriers::ImageAccess access,
+                             uint32_t mipstart, uint32_t mipcount) {
+    if (mipcount == (uint32_t)-1) mipcount = this->mipcount - mipstart;
+    batch.transition(deviceImage,mipState + mipstart,mipstart,mipcount,access,layers);
+}
+
+void EngineImage::transition(VkCommandBuffer cb, renderer::barriers::ImageAccess access, uint32_t mipstart,
+                             uint32_t mipcount) {
+    thread_local renderer::barriers::BarrierBatch batch;
+    transition(batch,access,mipstart,mipcount);
+    batch.flush(cb);
+}
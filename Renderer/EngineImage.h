@@ -4,12 +4,29 @@
 
 #ifndef ENGINEIMAGE_H
 #define ENGINEIMAGE_H
-#include <vector>
 #include <volk.h>
 #include <vk_mem_alloc.h>
 
+#include "Barriers.h"
+#include "renderer_constants.h"
 #include "../love_resource_locator.h"
 
+/// an image whose whole mip chain was built offline, cooked textures and KTX2 files
+struct PrebuiltImage {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0, height = 0;
+    uint32_t mipcount = 1;
+    uint32_t layers = 1;
+    uint32_t block_extent = 1;  // texels along a block edge, 4 for BCn formats
+    uint32_t block_size = 0;    // bytes per block, or per texel when uncompressed
+    const uint8_t *levels[MAX_IMAGE_MIPS] = {}; // each level's layers back to back
+
+    /// bytes of one layer of level
+    size_t level_size(uint32_t level) const {
+        const uint32_t w = width >> level ? width >> level : 1, h = height >> level ? height >> level : 1;
+        return (size_t)((w + block_extent - 1) / block_extent) * ((h + block_extent - 1) / block_extent) * block_size;
+    }
+};
 
 class EngineImage {
     public:
@@ -17,16 +34,46 @@ class EngineImage {
     VkImageView imageView;
     VmaAllocation allocation;
     uint32_t width, height;
-    std::vector<VkImageLayout> imageLayout;
+    renderer::barriers::SubresourceState mipState[MAX_IMAGE_MIPS];
     VmaAllocationInfo  alloc_info;
     VkFormat format;
     uint32_t mipcount;
+    uint32_t layers = 1;
+    bool uploaded = false;     // set once the last staging copy is recorded
+    uint64_t upload_value = 0; // timeline value after which the contents are valid on the GPU
+    uint32_t bindless = UINT32_MAX; // slot in the bindless texture table for sampled images, usable once uploaded
 
-private:
-    ::EngineImage *make(struct ::VkCommandBuffer_T *cb, ResourceLocator image_source, VkImageUsageFlags usage, bool generate_mips);
+    /**
+     * decodes image_source and queues it on the staging ring, the copy goes out with this frame's uploads
+     * .ktx2 files are uploaded as stored, with their own mip chain and layers, and generate_mips is ignored
+     * the caller owns the image, shared textures go through renderer::streaming::request instead
+     */
+    static EngineImage *make(ResourceLocator image_source, VkImageUsageFlags usage, bool generate_mips);
+    /**
+     * same as make for pixels decoded elsewhere
+     * @param pixels tightly packed rows of channels bytes per texel, owned by the image until release is called.
+     * RGB, and gray or gray alpha on devices without R8/R8G8 support, is widened to RGBA8 on the staging copy
+     */
+    static EngineImage *make_from_pixels(uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels,
+                                         VkImageUsageFlags usage, bool generate_mips, void (*release)(void *));
+    /**
+     * uploads every level and layer of source as is, nothing is generated on the GPU. Images with more than one
+     * layer get a 2D array view and no bindless slot
+     * @param owner what source's levels point into, kept until release(owner) is called
+     */
+    static EngineImage *make_prebuilt(const PrebuiltImage &source, VkImageUsageFlags usage, void *owner,
+                                      void (*release)(void *));
+    /// queues the image and view for deferred deletion, the object itself stays with the caller
+    void destroy();
 
-    void ChangeImageLayout(VkCommandBuffer cb, VkImageLayout newLayout, VkPipelineStageFlags srcstage,
-                           VkPipelineStageFlags dststage, uint32_t mipstart=0, uint32_t mipcount=-1);
+    /// adds the barriers the next access to the levels needs to batch, nothing if it already sees the data
+    void transition(renderer::barriers::BarrierBatch &batch, renderer::barriers::ImageAccess access,
+                    uint32_t mipstart=0, uint32_t mipcount=-1);
+    /// same, recorded into cb right away
+    void transition(VkCommandBuffer cb, renderer::barriers::ImageAccess access, uint32_t mipstart=0, uint32_t mipcount=-1);
+
+private:
+    void finish_upload(VkCommandBuffer cb, bool generate_mips);
 };
 
 
@@ -0,0 +1,97 @@
+#include "FrameAllocator.h"
+#include <algorithm>
+#include <atomic>
+#include <SDL3/SDL_log.h>
+
+#include "Renderer.h"
+#include "renderer_constants.h"
+#include "../debug_panic.h"
+
+namespace renderer::linear {
+    namespace {
+        struct Arena {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            uint8_t *mapped = nullptr;
+            VkDeviceAddress address = 0;
+        };
+        Arena arenas[MAX_INFLIGHT_FRAMES];
+        uint32_t slot = 0;
+        std::atomic<VkDeviceSize> head = 0;
+        std::atomic<uint32_t> failed = 0;
+        VkDeviceSize peak = 0;
+        VkDeviceSize uniformAlignment = 256;
+    }
+
+    void init() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+        uniformAlignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+
+        for (auto &arena : arenas) {
+            VkBufferCreateInfo buffer_info = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .size = FRAME_ALLOCATOR_SIZE,
+                .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            };
+            // AUTO lets VMA pick host visible VRAM (ReBAR/UMA) when there is some
+            VmaAllocationCreateInfo vmaInfo = {
+                .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                .usage = VMA_MEMORY_USAGE_AUTO,
+            };
+            VmaAllocationInfo info;
+            if (vmaCreateBuffer(vma_allocator, &buffer_info, &vmaInfo, &arena.buffer, &arena.allocation, &info) != VK_SUCCESS) {
+                SDL_Log("[linear] Error: could not allocate frame arena");
+                panic();
+            }
+            arena.mapped = (uint8_t *)info.pMappedData;
+            VkBufferDeviceAddressInfo address_info = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+                .buffer = arena.buffer,
+            };
+            arena.address = vkGetBufferDeviceAddress(device, &address_info);
+        }
+    }
+    void shutdown() {
+        for (auto &arena : arenas) {
+            vmaDestroyBuffer(vma_allocator, arena.buffer, arena.allocation);
+            arena = {};
+        }
+    }
+    void begin_frame(uint32_t frame_slot) {
+        peak = std::max(peak, head.load(std::memory_order_relaxed));
+        slot = frame_slot;
+        head.store(0, std::memory_order_relaxed);
+        failed.store(0, std::memory_order_relaxed);
+    }
+    void flush() {
+        const VkDeviceSize used = head.load(std::memory_order_acquire);
+        if (used > 0)
+            vmaFlushAllocation(vma_allocator, arenas[slot].allocation, 0, std::min<VkDeviceSize>(used, FRAME_ALLOCATOR_SIZE));
+    }
+
+    FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment) {
+        const Arena &arena = arenas[slot];
+        VkDeviceSize current = head.load(std::memory_order_relaxed);
+        VkDeviceSize offset;
+        do {
+            offset = (current + alignment - 1) / alignment * alignment;
+            if (offset + size > FRAME_ALLOCATOR_SIZE) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+                return {arena.buffer, 0, nullptr, 0};
+            }
+        } while (!head.compare_exchange_weak(current, offset + size, std::memory_order_acq_rel));
+        return {arena.buffer, offset, arena.mapped + offset, arena.address + offset};
+    }
+    FrameAllocation allocate_uniform(VkDeviceSize size) {
+        return allocate(size, uniformAlignment);
+    }
+
+    LinearStats stats() {
+        const VkDeviceSize used = head.load(std::memory_order_relaxed);
+        return {used, std::max(peak, used), FRAME_ALLOCATOR_SIZE, failed.load(std::memory_order_relaxed)};
+    }
+}
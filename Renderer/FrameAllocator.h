@@ -0,0 +1,43 @@
+#ifndef FRAMEALLOCATOR_H
+#define FRAMEALLOCATOR_H
+#include <cstdint>
+#include <volk.h>
+#include <vk_mem_alloc.h>
+
+/**
+ * Per-frame linear allocator for dynamic GPU data (uniforms, vertices, indices, storage). Each in-flight
+ * frame owns a persistently mapped FRAME_ALLOCATOR_SIZE buffer, allocations are a bump of an atomic offset
+ * and everything is released at once when advance_frame_and_execute_cleanups() reuses the slot.
+ */
+namespace renderer::linear {
+    struct FrameAllocation {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        void *ptr;              // nullptr when the frame ran out of space
+        VkDeviceAddress address; // buffer device address of ptr
+    };
+
+    void init();
+    void shutdown();
+    void begin_frame(uint32_t frame_slot);
+    /// flushes what this frame wrote, call before the submit reading it
+    void flush();
+
+    /// safe to call from any thread, valid until this frame slot comes around again
+    FrameAllocation allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+    /// allocate() aligned to minUniformBufferOffsetAlignment
+    FrameAllocation allocate_uniform(VkDeviceSize size);
+    template<class T>
+    FrameAllocation allocate_array(uint32_t count) {
+        return allocate(sizeof(T) * count, alignof(T) > 16 ? alignof(T) : 16);
+    }
+
+    struct LinearStats {
+        VkDeviceSize used;      // bytes handed out this frame
+        VkDeviceSize peak;
+        VkDeviceSize capacity;
+        uint32_t failed;        // allocations that did not fit this frame
+    };
+    LinearStats stats();
+}
+#endif //FRAMEALLOCATOR_H
@@ -0,0 +1,196 @@
+#include "FramePacing.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+#include "GpuTimeline.h"
+#include "Renderer.h"
+#include "Swapchain.h"
+#include "renderer_constants.h"
+
+namespace renderer::pacing {
+    namespace {
+        constexpr uint32_t history_size = 240;
+        // sleeps overshoot by up to a scheduler tick, the last stretch before the deadline is spun instead
+        constexpr uint64_t spin_ns = 2000000;
+
+        struct InFlight {
+            uint64_t value;
+            uint64_t start_ns;
+        };
+        struct History {
+            float samples[history_size] = {};
+            uint32_t count = 0;
+            uint32_t head = 0;
+
+            void push(float sample) {
+                samples[head] = sample;
+                head = (head + 1) % history_size;
+                count = std::min(count + 1, history_size);
+            }
+            float average() const {
+                float sum = 0;
+                for (uint32_t i = 0; i < count; i++)
+                    sum += samples[i];
+                return count ? sum / (float)count : 0.0f;
+            }
+            float p95() const {
+                if (count == 0)
+                    return 0;
+                std::vector<float> sorted(samples, samples + count);
+                std::sort(sorted.begin(), sorted.end());
+                return sorted[std::min<size_t>(count - 1, (size_t)(0.95f * (float)(count - 1) + 0.5f))];
+            }
+        };
+
+        VkPresentModeKHR requestedMode = VK_PRESENT_MODE_FIFO_KHR;
+        uint32_t framesInFlight = MAX_INFLIGHT_FRAMES;
+        uint64_t targetNs = 0;
+
+        std::deque<InFlight> inFlight;      // submitted frames not yet seen complete, oldest first
+        uint64_t frameStart = 0;            // 0 until the first begin_frame
+        uint64_t deadline = 0;
+        History frameTimes, cpuTimes, throttleTimes, limiterTimes, latencies;
+
+        float ms(uint64_t ns) {
+            return (float)ns / 1e6f;
+        }
+
+        // latency of every frame the GPU finished since the last call, as seen from now. Called at both ends of a
+        // frame and after every wait, so a completion is stamped no later than the end of the work it overlapped
+        void retire(uint64_t now) {
+            const uint64_t completed = timeline::completed_value();
+            while (!inFlight.empty() && inFlight.front().value <= completed) {
+                latencies.push(ms(now - inFlight.front().start_ns));
+                inFlight.pop_front();
+            }
+        }
+
+        void limit() {
+            if (targetNs == 0 || frameStart == 0) {
+                deadline = 0;
+                return;
+            }
+            const uint64_t now = SDL_GetTicksNS();
+            // a frame that overran by more than a whole period starts a new schedule instead of bursting to catch up
+            deadline = deadline == 0 || now > deadline + targetNs ? now : deadline;
+            if (now < deadline) {
+                // the sleep waits on the oldest frame in flight, so its latency is stamped when the GPU finishes it
+                for (uint64_t t = now; t + spin_ns < deadline; t = SDL_GetTicksNS()) {
+                    if (inFlight.empty()) {
+                        SDL_DelayNS(deadline - t - spin_ns);
+                        break;
+                    }
+                    if (!timeline::wait(inFlight.front().value, deadline - t - spin_ns))
+                        break;
+                    retire(SDL_GetTicksNS());
+                }
+                while (SDL_GetTicksNS() < deadline) {}
+            }
+            limiterTimes.push(ms(SDL_GetTicksNS() - now));
+            deadline += targetNs;
+        }
+
+        void throttle() {
+            const uint64_t start = SDL_GetTicksNS();
+            retire(start);
+            while (inFlight.size() >= framesInFlight) {
+                timeline::wait(inFlight.front().value);
+                retire(SDL_GetTicksNS());
+            }
+            throttleTimes.push(ms(SDL_GetTicksNS() - start));
+        }
+    }
+
+    void set_present_mode(VkPresentModeKHR mode) {
+        if (mode == requestedMode)
+            return;
+        requestedMode = mode;
+        if (swapchain::surface() != VK_NULL_HANDLE)
+            g_SwapChainRebuild = true;
+    }
+    VkPresentModeKHR requested_present_mode() {
+        return requestedMode;
+    }
+    bool present_mode_supported(VkSurfaceKHR surface, VkPresentModeKHR mode) {
+        if (surface == VK_NULL_HANDLE)
+            return false;
+        uint32_t count = 0;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(g_PhysicalDevice, surface, &count, nullptr);
+        std::vector<VkPresentModeKHR> modes(count);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(g_PhysicalDevice, surface, &count, modes.data());
+        return std::find(modes.begin(), modes.end(), mode) != modes.end();
+    }
+    VkPresentModeKHR select_present_mode(VkSurfaceKHR surface) {
+        if (requestedMode == VK_PRESENT_MODE_FIFO_KHR || present_mode_supported(surface, requestedMode))
+            return requestedMode;
+        SDL_Log("[pacing] Warning: present mode %s is not supported by the surface, using fifo", present_mode_name(requestedMode));
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+    const char *present_mode_name(VkPresentModeKHR mode) {
+        switch (mode) {
+            case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "relaxed";
+            case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+            case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+            default: return "unknown";
+        }
+    }
+    bool parse_present_mode(const char *name, VkPresentModeKHR *mode) {
+        const VkPresentModeKHR modes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+                                          VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+        for (VkPresentModeKHR candidate : modes) {
+            if (strcmp(name, present_mode_name(candidate)) == 0) {
+                *mode = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void set_frames_in_flight(uint32_t frames) {
+        framesInFlight = std::clamp<uint32_t>(frames, 1, MAX_INFLIGHT_FRAMES);
+    }
+    uint32_t frames_in_flight() {
+        return framesInFlight;
+    }
+    void set_target_frame_ms(float target_ms) {
+        targetNs = target_ms > 0 ? (uint64_t)(target_ms * 1e6f) : 0;
+    }
+    float target_frame_ms() {
+        return ms(targetNs);
+    }
+
+    void begin_frame() {
+        retire(SDL_GetTicksNS());
+        limit();
+        throttle();
+        const uint64_t now = SDL_GetTicksNS();
+        if (frameStart != 0)
+            frameTimes.push(ms(now - frameStart));
+        frameStart = now;
+    }
+    void end_frame(uint64_t value) {
+        // frameStart is taken after the limiter and throttle, so this is only the frame's own work
+        const uint64_t now = SDL_GetTicksNS();
+        cpuTimes.push(ms(now - frameStart));
+        retire(now);
+        if (inFlight.empty() || inFlight.back().value < value)
+            inFlight.push_back({value, frameStart});
+    }
+
+    PacingStats stats() {
+        return {
+            .frame_ms = frameTimes.average(),
+            .frame_p95_ms = frameTimes.p95(),
+            .cpu_ms = cpuTimes.average(),
+            .throttle_ms = throttleTimes.average(),
+            .limiter_ms = limiterTimes.average(),
+            .latency_ms = latencies.average(),
+            .latency_p95_ms = latencies.p95(),
+        };
+    }
+}
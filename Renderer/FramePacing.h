@@ -0,0 +1,49 @@
+#ifndef FRAMEPACING_H
+#define FRAMEPACING_H
+#include <cstdint>
+#include <volk.h>
+
+/**
+ * Frame pacing knobs that used to be compile time constants. The present mode is a request resolved against
+ * the surface whenever the swapchain is (re)built. CPU frames in flight are throttled on the timeline
+ * independently of the swapchain image count (g_MinImageCount) and bounded by MAX_INFLIGHT_FRAMES, the number
+ * of per-frame slots. An optional limiter sleeps, then spins, up to a target frame time.
+ */
+namespace renderer::pacing {
+    /// asks for a swapchain rebuild when the mode changes
+    void set_present_mode(VkPresentModeKHR mode);
+    VkPresentModeKHR requested_present_mode();
+    /// the requested mode if the surface supports it, FIFO otherwise since every surface has it
+    VkPresentModeKHR select_present_mode(VkSurfaceKHR surface);
+    bool present_mode_supported(VkSurfaceKHR surface, VkPresentModeKHR mode);
+    const char *present_mode_name(VkPresentModeKHR mode);
+    /// fifo, relaxed, mailbox or immediate
+    bool parse_present_mode(const char *name, VkPresentModeKHR *mode);
+
+    /// clamped to [1, MAX_INFLIGHT_FRAMES], 1 trades throughput for the lowest latency
+    void set_frames_in_flight(uint32_t frames);
+    uint32_t frames_in_flight();
+    /// 0 turns the limiter off
+    void set_target_frame_ms(float ms);
+    float target_frame_ms();
+
+    /**
+     * call at the top of the main loop before input is polled, so the input a frame samples is as fresh as the
+     * limiter and throttle allow
+     */
+    void begin_frame();
+    /// call once the frame's commands went out, value is the timeline value of that submit
+    void end_frame(uint64_t value);
+
+    struct PacingStats {
+        float frame_ms;         // begin_frame to begin_frame, averaged over the history window
+        float frame_p95_ms;
+        float cpu_ms;           // begin_frame to end_frame, after the waits below
+        float throttle_ms;      // waiting for the GPU to drop below frames_in_flight()
+        float limiter_ms;       // sleeping for the target frame time
+        float latency_ms;       // begin_frame until the timeline showed the GPU finished that frame
+        float latency_p95_ms;
+    };
+    PacingStats stats();
+}
+#endif //FRAMEPACING_H
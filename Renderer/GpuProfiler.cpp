@@ -0,0 +1,172 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <cstring>
+#include <SDL3/SDL_log.h>
+
+#include "GpuTimeline.h"
+#include "Renderer.h"
+#include "renderer_constants.h"
+
+namespace renderer::gpu_profiler {
+    namespace {
+        constexpr uint32_t history_size = 240;
+
+        struct FrameQueries {
+            const char *names[MAX_GPU_PROFILER_ZONES];
+            uint32_t count = 0;
+            uint64_t value = 0; // timeline value of the submit carrying the queries, 0 when nothing is pending
+        };
+        struct PassHistory {
+            const char *name;
+            float samples[history_size];
+            uint32_t count = 0;
+            uint32_t head = 0;  // next sample to overwrite
+        };
+
+        VkQueryPool pool = VK_NULL_HANDLE;
+        float periodNs = 1.0f;
+        uint64_t validMask = 0;
+        FrameQueries frames[MAX_INFLIGHT_FRAMES];
+        uint32_t slot = 0;
+        uint32_t dropped = 0;
+        std::vector<PassHistory> passes;
+        std::vector<float> sorted;
+
+        uint32_t first_query(uint32_t frame) {
+            return frame * MAX_GPU_PROFILER_ZONES * 2;
+        }
+
+        PassHistory &pass(const char *name) {
+            for (auto &p : passes)
+                if (p.name == name || strcmp(p.name, name) == 0)
+                    return p;
+            passes.push_back({.name = name});
+            return passes.back();
+        }
+
+        void collect(FrameQueries &frame) {
+            if (frame.count == 0)
+                return;
+            if (!timeline::is_complete(frame.value)) {
+                dropped++;
+                return;
+            }
+            uint64_t results[MAX_GPU_PROFILER_ZONES * 2];
+            VkResult err = vkGetQueryPoolResults(device, pool, first_query(slot), frame.count * 2, sizeof(results),
+                                                 results, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+            if (err != VK_SUCCESS) {
+                dropped++;
+                return;
+            }
+            for (uint32_t i = 0; i < frame.count; i++) {
+                const uint64_t begin = results[i * 2] & validMask, end = results[i * 2 + 1] & validMask;
+                PassHistory &history = pass(frame.names[i]);
+                history.samples[history.head] = (float)((end - begin) & validMask) * periodNs / 1e6f;
+                history.head = (history.head + 1) % history_size;
+                history.count = std::min(history.count + 1, history_size);
+            }
+        }
+
+        float percentile(float p) {
+            const size_t index = std::min(sorted.size() - 1, (size_t)(p * (float)(sorted.size() - 1) + 0.5f));
+            return sorted[index];
+        }
+    }
+
+    void init() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+        uint32_t count;
+        vkGetPhysicalDeviceQueueFamilyProperties(g_PhysicalDevice, &count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(count);
+        vkGetPhysicalDeviceQueueFamilyProperties(g_PhysicalDevice, &count, families.data());
+        const uint32_t valid_bits = families[g_QueueFamily].timestampValidBits;
+        if (valid_bits == 0 || properties.limits.timestampPeriod == 0.0f) {
+            SDL_Log("[gpu profiler] Timestamps are not supported on the graphics queue, profiling is off");
+            return;
+        }
+        periodNs = properties.limits.timestampPeriod;
+        validMask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+        VkQueryPoolCreateInfo info = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = MAX_INFLIGHT_FRAMES * MAX_GPU_PROFILER_ZONES * 2,
+        };
+        if (vkCreateQueryPool(device, &info, g_vk_Allocator, &pool) != VK_SUCCESS) {
+            SDL_Log("[gpu profiler] Warning: could not create the query pool, profiling is off");
+            pool = VK_NULL_HANDLE;
+        }
+        for (auto &frame : frames)
+            frame = {};
+        slot = 0;
+    }
+    void shutdown() {
+        if (pool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(device, pool, g_vk_Allocator);
+        pool = VK_NULL_HANDLE;
+        passes.clear();
+    }
+
+    void begin_frame(VkCommandBuffer cb) {
+        if (pool == VK_NULL_HANDLE)
+            return;
+        slot = (slot + 1) % MAX_INFLIGHT_FRAMES;
+        FrameQueries &frame = frames[slot];
+        collect(frame);
+        frame.count = 0;
+        frame.value = 0;
+        vkCmdResetQueryPool(cb, pool, first_query(slot), MAX_GPU_PROFILER_ZONES * 2);
+    }
+    void end_frame() {
+        if (pool != VK_NULL_HANDLE)
+            frames[slot].value = timeline::pending_value();
+    }
+
+    uint32_t begin_zone(VkCommandBuffer cb, const char *name) {
+        if (pool == VK_NULL_HANDLE)
+            return UINT32_MAX;
+        FrameQueries &frame = frames[slot];
+        if (frame.count == MAX_GPU_PROFILER_ZONES)
+            return UINT32_MAX;
+        const uint32_t zone = frame.count++;
+        frame.names[zone] = name;
+        vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, first_query(slot) + zone * 2);
+        return zone;
+    }
+    void end_zone(VkCommandBuffer cb, uint32_t zone) {
+        if (zone == UINT32_MAX)
+            return;
+        vkCmdWriteTimestamp(cb, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool, first_query(slot) + zone * 2 + 1);
+    }
+
+    bool supported() {
+        return pool != VK_NULL_HANDLE;
+    }
+    uint32_t dropped_frames() {
+        return dropped;
+    }
+    void stats(std::vector<PassStats> &out) {
+        out.clear();
+        for (const auto &history : passes) {
+            if (history.count == 0)
+                continue;
+            const uint32_t offset = history.count == history_size ? history.head : 0;
+            sorted.assign(history.samples, history.samples + history.count);
+            std::sort(sorted.begin(), sorted.end());
+            float sum = 0;
+            for (float ms : sorted)
+                sum += ms;
+            out.push_back({
+                .name = history.name,
+                .last_ms = history.samples[(history.head + history_size - 1) % history_size],
+                .avg_ms = sum / (float)history.count,
+                .p95_ms = percentile(0.95f),
+                .p99_ms = percentile(0.99f),
+                .history = history.samples,
+                .history_count = history.count,
+                .history_offset = offset,
+            });
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+#include <cstdint>
+#include <vector>
+#include <volk.h>
+
+/**
+ * Timestamp query profiler for GPU passes. Every in-flight frame owns a range of 2 * MAX_GPU_PROFILER_ZONES
+ * queries in one pool. A frame's results are read when its slot comes around again and only if the timeline
+ * already passed the frame's submit, so reading never stalls, results are dropped instead.
+ */
+namespace renderer::gpu_profiler {
+    void init();
+    void shutdown();
+
+    /// collects the slot's previous results and resets its queries, cb must be outside a render pass
+    void begin_frame(VkCommandBuffer cb);
+    /// call right before the timeline submit that carries this frame's commands
+    void end_frame();
+
+    /**
+     * @param name string literal or otherwise static, passes are told apart by name
+     * @return zone index for end_zone, UINT32_MAX if the frame ran out of zones or timestamps are unsupported
+     */
+    uint32_t begin_zone(VkCommandBuffer cb, const char *name);
+    void end_zone(VkCommandBuffer cb, uint32_t zone);
+
+    /// begin_zone/end_zone around a scope
+    class Zone {
+    public:
+        Zone(VkCommandBuffer cb, const char *name) : cb(cb), zone(begin_zone(cb, name)) {}
+        ~Zone() { end_zone(cb, zone); }
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+    private:
+        VkCommandBuffer cb;
+        uint32_t zone;
+    };
+
+    struct PassStats {
+        const char *name;
+        float last_ms;
+        float avg_ms;   // over the history window
+        float p95_ms;
+        float p99_ms;
+        const float *history; // ring of the last history_count samples, oldest at history_offset
+        uint32_t history_count;
+        uint32_t history_offset;
+    };
+    bool supported();
+    /// frames whose results were dropped because the GPU had not finished them yet
+    uint32_t dropped_frames();
+    void stats(std::vector<PassStats> &out);
+}
+#endif //GPUPROFILER_H
@@ -0,0 +1,107 @@
+#include "GpuTimeline.h"
+#include <SDL3/SDL_log.h>
+
+#include "Renderer.h"
+#include "../debug_panic.h"
+
+namespace renderer::timeline {
+    static VkSemaphore semaphore = VK_NULL_HANDLE;
+    static uint64_t submitted = 0;
+    static uint64_t completed = 0;
+    static constexpr uint32_t max_signals = 8;
+
+    void init() {
+        VkSemaphoreTypeCreateInfo type_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = 0,
+        };
+        VkSemaphoreCreateInfo info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_info,
+        };
+        if (vkCreateSemaphore(device, &info, g_vk_Allocator, &semaphore) != VK_SUCCESS) {
+            SDL_Log("[vulkan] Error: failed to create timeline semaphore");
+            panic();
+        }
+        submitted = completed = 0;
+    }
+    void shutdown() {
+        vkDestroySemaphore(device, semaphore, g_vk_Allocator);
+        semaphore = VK_NULL_HANDLE;
+    }
+
+    uint64_t pending_value() { return submitted + 1; }
+    uint64_t last_submitted() { return submitted; }
+
+    uint64_t completed_value() {
+        if (completed < submitted) {
+            uint64_t value = 0;
+            vkGetSemaphoreCounterValue(device, semaphore, &value);
+            completed = value;
+        }
+        return completed;
+    }
+    bool is_complete(uint64_t value) {
+        return value <= completed || value <= completed_value();
+    }
+    void wait(uint64_t value) {
+        wait(value, UINT64_MAX);
+    }
+    bool wait(uint64_t value, uint64_t timeout_ns) {
+        if (value > submitted) {
+            // nothing will ever signal this, waiting would hang forever
+            SDL_Log("[vulkan] Error: waiting on unsubmitted timeline value %llu", (unsigned long long)value);
+            panic();
+        }
+        if (is_complete(value))
+            return true;
+        VkSemaphoreWaitInfo info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &semaphore,
+            .pValues = &value,
+        };
+        if (vkWaitSemaphores(device, &info, timeout_ns) != VK_SUCCESS)
+            return false;
+        completed = value > completed ? value : completed;
+        return true;
+    }
+    void wait_idle() {
+        wait(submitted);
+    }
+
+    uint64_t submit(VkQueue queue, const VkSubmitInfo &info, VkFence fence, const uint64_t *wait_values) {
+        if (info.signalSemaphoreCount + 1 > max_signals) panic();
+        const uint64_t value = submitted + 1;
+
+        // binary semaphores ignore their values but the arrays still have to line up
+        VkSemaphore signals[max_signals];
+        uint64_t signal_values[max_signals] = {};
+        for (uint32_t i = 0; i < info.signalSemaphoreCount; i++)
+            signals[i] = info.pSignalSemaphores[i];
+        signals[info.signalSemaphoreCount] = semaphore;
+        signal_values[info.signalSemaphoreCount] = value;
+
+        VkTimelineSemaphoreSubmitInfo timeline_info = {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .pNext = info.pNext,
+            .waitSemaphoreValueCount = wait_values ? info.waitSemaphoreCount : 0,
+            .pWaitSemaphoreValues = wait_values,
+            .signalSemaphoreValueCount = info.signalSemaphoreCount + 1,
+            .pSignalSemaphoreValues = signal_values,
+        };
+        VkSubmitInfo chained = info;
+        chained.pNext = &timeline_info;
+        chained.signalSemaphoreCount = info.signalSemaphoreCount + 1;
+        chained.pSignalSemaphores = signals;
+
+        VkResult err = vkQueueSubmit(queue, 1, &chained, fence);
+        if (err != VK_SUCCESS) {
+            SDL_Log("[vulkan] Error: vkQueueSubmit VkResult = %d", err);
+            panic();
+        }
+        submitted = value;
+        return value;
+    }
+}
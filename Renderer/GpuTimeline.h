@@ -0,0 +1,36 @@
+#ifndef GPUTIMELINE_H
+#define GPUTIMELINE_H
+#include <cstdint>
+#include <volk.h>
+
+/**
+ * GPU progress tracker on a Vulkan 1.2 timeline semaphore. Every submit through submit() signals the next
+ * value, so anything recorded before that submit is finished on the GPU once completed_value() reaches it.
+ * Submits are expected from the main thread only.
+ */
+namespace renderer::timeline {
+    void init();
+    void shutdown();
+
+    /// value the next submit() will signal, resources used by commands recorded now retire at this value
+    uint64_t pending_value();
+    uint64_t last_submitted();
+    /// polls the semaphore counter, cheap enough to call every frame
+    uint64_t completed_value();
+    bool is_complete(uint64_t value);
+    /// blocks until the GPU reaches value, returns immediately if it already did
+    void wait(uint64_t value);
+    /// wait() that gives up after timeout_ns, true once the GPU reached value
+    bool wait(uint64_t value, uint64_t timeout_ns);
+    void wait_idle();
+
+    /**
+     * vkQueueSubmit for a single batch with the timeline signal appended
+     * @param info submit info, may already carry binary wait/signal semaphores
+     * @param wait_values one per info.pWaitSemaphores, needed when any of them is a timeline semaphore
+     * @return the timeline value that is signaled when this batch completes
+     */
+    uint64_t submit(VkQueue queue, const VkSubmitInfo &info, VkFence fence = VK_NULL_HANDLE,
+                    const uint64_t *wait_values = nullptr);
+}
+#endif //GPUTIMELINE_H
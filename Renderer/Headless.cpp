@@ -0,0 +1,166 @@
+#include "Headless.h"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <SDL3/SDL_log.h>
+#include <nlohmann/json.hpp>
+
+#include "Renderer.h"
+#include "renderer_constants.h"
+#include "../debug_panic.h"
+
+namespace renderer::headless {
+    namespace {
+        // UNORM keeps readbacks byte exact
+        constexpr VkFormat target_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+        HeadlessFrame frames[MAX_INFLIGHT_FRAMES] = {};
+        uint32_t next = 0;
+        uint32_t targetWidth = 0, targetHeight = 0;
+        std::vector<float> frameTimes;
+
+        void check(VkResult err, const char *what) {
+            if (err == VK_SUCCESS)
+                return;
+            SDL_Log("[headless] Error: %s VkResult = %d", what, err);
+            panic();
+        }
+
+        void create_frame(HeadlessFrame &frame) {
+            VkImageCreateInfo image_info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                .imageType = VK_IMAGE_TYPE_2D,
+                .format = target_format,
+                .extent = {targetWidth, targetHeight, 1},
+                .mipLevels = 1,
+                .arrayLayers = 1,
+                .samples = VK_SAMPLE_COUNT_1_BIT,
+                .tiling = VK_IMAGE_TILING_OPTIMAL,
+                .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            };
+            VmaAllocationCreateInfo vmaInfo = {
+                .flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+                .usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            };
+            check(vmaCreateImage(vma_allocator, &image_info, &vmaInfo, &frame.image, &frame.allocation, nullptr), "vmaCreateImage");
+
+            VkImageViewCreateInfo view_info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = frame.image,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = target_format,
+                .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+            };
+            check(vkCreateImageView(device, &view_info, g_vk_Allocator, &frame.view), "vkCreateImageView");
+
+            VkCommandPoolCreateInfo pool_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .queueFamilyIndex = g_QueueFamily,
+            };
+            check(vkCreateCommandPool(device, &pool_info, g_vk_Allocator, &frame.command_pool), "vkCreateCommandPool");
+            VkCommandBufferAllocateInfo cb_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .commandPool = frame.command_pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                .commandBufferCount = 1,
+            };
+            check(vkAllocateCommandBuffers(device, &cb_info, &frame.command_buffer), "vkAllocateCommandBuffers");
+            // signaled so the first wait on every target returns right away, as with swapchain frames
+            VkFenceCreateInfo fence_info = {
+                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+            };
+            check(vkCreateFence(device, &fence_info, g_vk_Allocator, &frame.fence), "vkCreateFence");
+        }
+
+        float percentile(const std::vector<float> &sorted, float p) {
+            const size_t index = std::min(sorted.size() - 1, (size_t)(p * (float)(sorted.size() - 1) + 0.5f));
+            return sorted[index];
+        }
+    }
+
+    void init(uint32_t width, uint32_t height) {
+        targetWidth = width;
+        targetHeight = height;
+        for (auto &frame : frames)
+            create_frame(frame);
+        next = 0;
+        frameTimes.clear();
+    }
+    void shutdown() {
+        for (auto &frame : frames) {
+            vkDestroyFence(device, frame.fence, g_vk_Allocator);
+            vkDestroyCommandPool(device, frame.command_pool, g_vk_Allocator);
+            vkDestroyImageView(device, frame.view, g_vk_Allocator);
+            vmaDestroyImage(vma_allocator, frame.image, frame.allocation);
+            frame = {};
+        }
+    }
+
+    VkFormat format() { return target_format; }
+    uint32_t width() { return targetWidth; }
+    uint32_t height() { return targetHeight; }
+    uint32_t frame_count() { return MAX_INFLIGHT_FRAMES; }
+
+    HeadlessFrame &next_frame() {
+        HeadlessFrame &frame = frames[next];
+        next = (next + 1) % MAX_INFLIGHT_FRAMES;
+        return frame;
+    }
+
+    void record_frame(float frame_ms) {
+        frameTimes.push_back(frame_ms);
+    }
+    BenchmarkStats benchmark_stats() {
+        BenchmarkStats stats = {};
+        if (frameTimes.empty())
+            return stats;
+        std::vector<float> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        stats.frames = (uint32_t)sorted.size();
+        for (float ms : sorted)
+            stats.total_ms += ms;
+        stats.min_ms = sorted.front();
+        stats.max_ms = sorted.back();
+        stats.avg_ms = stats.total_ms / (float)stats.frames;
+        stats.p50_ms = percentile(sorted, 0.50f);
+        stats.p95_ms = percentile(sorted, 0.95f);
+        stats.p99_ms = percentile(sorted, 0.99f);
+        return stats;
+    }
+    void log_stats() {
+        const BenchmarkStats stats = benchmark_stats();
+        SDL_Log("[headless] %u frames at %ux%u in %.1f ms, avg %.3f ms (%.1f fps), min %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f",
+                stats.frames, targetWidth, targetHeight, stats.total_ms, stats.avg_ms,
+                stats.avg_ms > 0 ? 1000.0f / stats.avg_ms : 0.0f, stats.min_ms, stats.p50_ms, stats.p95_ms,
+                stats.p99_ms, stats.max_ms);
+    }
+    bool write_stats(const char *path) {
+        const BenchmarkStats stats = benchmark_stats();
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+        nlohmann::json json = {
+            {"device", properties.deviceName},
+            {"width", targetWidth},
+            {"height", targetHeight},
+            {"frames", stats.frames},
+            {"total_ms", stats.total_ms},
+            {"min_ms", stats.min_ms},
+            {"avg_ms", stats.avg_ms},
+            {"p50_ms", stats.p50_ms},
+            {"p95_ms", stats.p95_ms},
+            {"p99_ms", stats.p99_ms},
+            {"max_ms", stats.max_ms},
+            {"frame_ms", frameTimes},
+        };
+        std::ofstream file(path);
+        if (!file) {
+            SDL_Log("[headless] Warning: could not write %s", path);
+            return false;
+        }
+        file << json.dump(2) << '\n';
+        return (bool)file;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+#include <cstdint>
+#include <volk.h>
+#include <vk_mem_alloc.h>
+
+/**
+ * Offscreen render targets for running without SDL video or WSI (benchmarks, CI, software ICDs like lavapipe).
+ * Frames cycle through MAX_INFLIGHT_FRAMES VMA allocated color images, each with its own command pool and
+ * fence like a swapchain frame, so FrameRender drives them the same way. Each frame leaves its image in
+ * TRANSFER_SRC_OPTIMAL for readbacks.
+ */
+namespace renderer::headless {
+    struct HeadlessFrame {
+        VkImage image;
+        VmaAllocation allocation;
+        VkImageView view;
+        VkCommandPool command_pool;
+        VkCommandBuffer command_buffer;
+        VkFence fence;
+    };
+
+    /// call after renderer::init() when g_Headless is set
+    void init(uint32_t width, uint32_t height);
+    /// device must be idle
+    void shutdown();
+
+    /// color attachment format for pipelines that draw into the targets
+    VkFormat format();
+    uint32_t width();
+    uint32_t height();
+    uint32_t frame_count();
+    /// the next target in round robin order, its fence tells when its previous use finished
+    HeadlessFrame &next_frame();
+
+    struct BenchmarkStats {
+        uint32_t frames;
+        float total_ms;
+        float min_ms, avg_ms, p50_ms, p95_ms, p99_ms, max_ms;
+    };
+    /// wall time from one frame start to the next
+    void record_frame(float frame_ms);
+    BenchmarkStats benchmark_stats();
+    void log_stats();
+    /// writes benchmark_stats() and the device name as JSON for CI
+    bool write_stats(const char *path);
+}
+#endif //HEADLESS_H
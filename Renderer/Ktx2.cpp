@@ -0,0 +1,164 @@
+#include "Ktx2.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <SDL3/SDL_log.h>
+#include <volk.h>
+#include "EngineImage.h"
+#include "Renderer.h"
+
+namespace renderer::ktx2 {
+    namespace {
+        const uint8_t IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+        struct Header {
+            uint8_t identifier[12];
+            uint32_t vkFormat;
+            uint32_t typeSize;
+            uint32_t pixelWidth, pixelHeight, pixelDepth;
+            uint32_t layerCount, faceCount, levelCount;
+            uint32_t supercompressionScheme;
+            uint32_t dfdByteOffset, dfdByteLength;
+            uint32_t kvdByteOffset, kvdByteLength;
+            uint64_t sgdByteOffset, sgdByteLength;
+        };
+        static_assert(sizeof(Header) == 80, "KTX2 header is 80 bytes");
+
+        struct LevelIndex {
+            uint64_t byteOffset;
+            uint64_t byteLength;
+            uint64_t uncompressedByteLength;
+        };
+
+        struct BlockInfo {
+            uint32_t extent;    // texels along a block edge, 1 for uncompressed formats
+            uint32_t size;      // bytes per block
+        };
+
+        // the formats the staging ring can copy as tightly packed rows, {0,0} for anything else
+        BlockInfo block_info(VkFormat format) {
+            switch (format) {
+                case VK_FORMAT_R8_UNORM:
+                case VK_FORMAT_R8_SRGB:
+                    return {1, 1};
+                case VK_FORMAT_R8G8_UNORM:
+                case VK_FORMAT_R8G8_SRGB:
+                case VK_FORMAT_R16_UNORM:
+                case VK_FORMAT_R16_SFLOAT:
+                    return {1, 2};
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                case VK_FORMAT_R8G8B8A8_SRGB:
+                case VK_FORMAT_B8G8R8A8_UNORM:
+                case VK_FORMAT_B8G8R8A8_SRGB:
+                case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+                case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+                case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+                case VK_FORMAT_R16G16_UNORM:
+                case VK_FORMAT_R16G16_SFLOAT:
+                case VK_FORMAT_R32_SFLOAT:
+                    return {1, 4};
+                case VK_FORMAT_R16G16B16A16_UNORM:
+                case VK_FORMAT_R16G16B16A16_SFLOAT:
+                case VK_FORMAT_R32G32_SFLOAT:
+                    return {1, 8};
+                case VK_FORMAT_R32G32B32A32_SFLOAT:
+                    return {1, 16};
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                case VK_FORMAT_BC4_SNORM_BLOCK:
+                    return {4, 8};
+                case VK_FORMAT_BC2_UNORM_BLOCK:
+                case VK_FORMAT_BC2_SRGB_BLOCK:
+                case VK_FORMAT_BC3_UNORM_BLOCK:
+                case VK_FORMAT_BC3_SRGB_BLOCK:
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                case VK_FORMAT_BC5_SNORM_BLOCK:
+                case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+                case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+                case VK_FORMAT_BC7_UNORM_BLOCK:
+                case VK_FORMAT_BC7_SRGB_BLOCK:
+                    return {4, 16};
+                default:
+                    return {0, 0};
+            }
+        }
+
+        bool sampleable(VkFormat format) {
+            VkFormatProperties properties;
+            vkGetPhysicalDeviceFormatProperties(g_PhysicalDevice, format, &properties);
+            const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+            return (properties.optimalTilingFeatures & needed) == needed;
+        }
+    }
+
+    bool is_ktx2(const uint8_t *data, size_t size) {
+        return size >= sizeof(IDENTIFIER) && memcmp(data, IDENTIFIER, sizeof(IDENTIFIER)) == 0;
+    }
+
+    bool parse(const uint8_t *data, size_t size, const char *name, PrebuiltImage &out) {
+        if (!is_ktx2(data, size) || size < sizeof(Header)) {
+            SDL_Log("[ktx2] Error: %s is not a KTX2 file", name);
+            return false;
+        }
+        Header header;
+        memcpy(&header, data, sizeof(header));
+        const VkFormat format = (VkFormat)header.vkFormat;
+        const BlockInfo block = block_info(format);
+        if (block.size == 0) {
+            SDL_Log("[ktx2] Error: %s uses unsupported format %u", name, header.vkFormat);
+            return false;
+        }
+        if (header.supercompressionScheme != 0) {
+            SDL_Log("[ktx2] Error: %s is supercompressed (scheme %u)", name, header.supercompressionScheme);
+            return false;
+        }
+        if (header.faceCount != 1 || header.pixelDepth > 1 || header.pixelHeight == 0 || header.pixelWidth == 0) {
+            SDL_Log("[ktx2] Error: %s is not a 2D texture or texture array", name);
+            return false;
+        }
+        if (!sampleable(format)) {
+            SDL_Log("[ktx2] Error: %s uses format %u, which the device can't sample", name, header.vkFormat);
+            return false;
+        }
+        // a level count of 0 asks the loader to generate the chain, only level 0 is stored then
+        const uint32_t levels = std::max(header.levelCount, 1u);
+        const uint32_t layers = std::max(header.layerCount, 1u);
+        if (levels > MAX_IMAGE_MIPS || levels > (uint32_t)std::bit_width(std::max(header.pixelWidth, header.pixelHeight))) {
+            SDL_Log("[ktx2] Error: %s has %u levels", name, levels);
+            return false;
+        }
+        if (size < sizeof(Header) + levels * sizeof(LevelIndex)) {
+            SDL_Log("[ktx2] Error: %s is truncated", name);
+            return false;
+        }
+
+        out = {
+            .format = format,
+            .width = header.pixelWidth,
+            .height = header.pixelHeight,
+            .mipcount = levels,
+            .layers = layers,
+            .block_extent = block.extent,
+            .block_size = block.size,
+        };
+        for (uint32_t level = 0; level < levels; level++) {
+            LevelIndex index;
+            memcpy(&index, data + sizeof(Header) + level * sizeof(LevelIndex), sizeof(index));
+            const uint64_t expected = (uint64_t)out.level_size(level) * layers;
+            if (index.byteLength != expected) {
+                SDL_Log("[ktx2] Error: level %u of %s is %llu bytes, expected %llu", level, name,
+                        (unsigned long long)index.byteLength, (unsigned long long)expected);
+                return false;
+            }
+            if (index.byteOffset > size || size - index.byteOffset < index.byteLength) {
+                SDL_Log("[ktx2] Error: %s is truncated", name);
+                return false;
+            }
+            out.levels[level] = data + index.byteOffset;
+        }
+        return true;
+    }
+}
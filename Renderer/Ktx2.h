@@ -0,0 +1,23 @@
+#ifndef KTX2_H
+#define KTX2_H
+#include <cstddef>
+#include <cstdint>
+
+struct PrebuiltImage;
+
+/**
+ * Reader for KTX2 containers holding 2D textures and texture arrays with their mip chains already built,
+ * uncompressed or BCn. Nothing is decoded: the parsed image points at the level data inside the file's bytes,
+ * which go to the staging ring as they are. Supercompressed files, cubemaps and 3D textures are rejected.
+ */
+namespace renderer::ktx2 {
+    /// true if data starts with the KTX2 identifier
+    bool is_ktx2(const uint8_t *data, size_t size);
+    /**
+     * validates the header and level index and fills out, whose level pointers point into data
+     * @param name only used in error messages
+     * @return false if the file is malformed or uses something EngineImage can't upload as is
+     */
+    bool parse(const uint8_t *data, size_t size, const char *name, PrebuiltImage &out);
+}
+#endif //KTX2_H
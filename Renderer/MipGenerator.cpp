@@ -0,0 +1,270 @@
+#include "MipGenerator.h"
+#include <algorithm>
+#include <vector>
+#include <SDL3/SDL_log.h>
+
+#include "EngineImage.h"
+#include "Renderer.h"
+#include "ResourceManager.h"
+#include "../debug_panic.h"
+
+namespace renderer::mips {
+    using barriers::ImageAccess;
+
+    namespace {
+        const uint32_t downsample_spv[] = {
+#include "downsample.comp.spv.h"
+        };
+        struct Push {
+            int32_t dst_size[2];
+            int32_t encode_srgb;
+        };
+
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkSampler sampler = VK_NULL_HANDLE;
+        std::vector<VkDescriptorPool> pools;
+        barriers::BarrierBatch batch;
+
+        // the compute path writes through a UNORM view, sRGB is encoded by the shader
+        VkFormat storage_format(VkFormat format) {
+            switch (format) {
+                case VK_FORMAT_R8G8B8A8_SRGB:
+                case VK_FORMAT_R8G8B8A8_UNORM:
+                    return VK_FORMAT_R8G8B8A8_UNORM;
+                default:
+                    return VK_FORMAT_UNDEFINED;
+            }
+        }
+
+        void create_pipeline() {
+            VkDescriptorSetLayoutBinding bindings[] = {
+                {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+                {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            };
+            VkDescriptorSetLayoutCreateInfo set_info = {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+                .bindingCount = 2,
+                .pBindings = bindings,
+            };
+            vkCreateDescriptorSetLayout(device, &set_info, g_vk_Allocator, &setLayout);
+
+            VkPushConstantRange range = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push)};
+            VkPipelineLayoutCreateInfo layout_info = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                .setLayoutCount = 1,
+                .pSetLayouts = &setLayout,
+                .pushConstantRangeCount = 1,
+                .pPushConstantRanges = &range,
+            };
+            vkCreatePipelineLayout(device, &layout_info, g_vk_Allocator, &pipelineLayout);
+
+            VkShaderModuleCreateInfo module_info = {
+                .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                .codeSize = sizeof(downsample_spv),
+                .pCode = downsample_spv,
+            };
+            VkShaderModule module;
+            vkCreateShaderModule(device, &module_info, g_vk_Allocator, &module);
+            VkComputePipelineCreateInfo pipeline_info = {
+                .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+                .stage = {
+                    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                    .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                    .module = module,
+                    .pName = "main",
+                },
+                .layout = pipelineLayout,
+            };
+            if (vkCreateComputePipelines(device, g_PipelineCache, 1, &pipeline_info, g_vk_Allocator, &pipeline) != VK_SUCCESS) {
+                SDL_Log("[mips] Error: could not create downsample pipeline");
+                panic();
+            }
+            vkDestroyShaderModule(device, module, g_vk_Allocator);
+
+            // texelFetch only, the filter is never used
+            VkSamplerCreateInfo sampler_info = {
+                .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+                .magFilter = VK_FILTER_NEAREST,
+                .minFilter = VK_FILTER_NEAREST,
+                .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+            };
+            vkCreateSampler(device, &sampler_info, g_vk_Allocator, &sampler);
+        }
+
+        VkDescriptorPool create_pool() {
+            VkDescriptorPoolSize sizes[] = {
+                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 64},
+                {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 64},
+            };
+            VkDescriptorPoolCreateInfo pool_info = {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+                .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+                .maxSets = 64,
+                .poolSizeCount = 2,
+                .pPoolSizes = sizes,
+            };
+            VkDescriptorPool pool;
+            vkCreateDescriptorPool(device, &pool_info, g_vk_Allocator, &pool);
+            pools.push_back(pool);
+            return pool;
+        }
+
+        // sets go back to their pool through deferred deletion once the dispatch ran
+        VkDescriptorSet allocate_set() {
+            VkDescriptorSetAllocateInfo alloc_info = {
+                .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                .descriptorSetCount = 1,
+                .pSetLayouts = &setLayout,
+            };
+            VkDescriptorSet set;
+            for (VkDescriptorPool pool : pools) {
+                alloc_info.descriptorPool = pool;
+                if (vkAllocateDescriptorSets(device, &alloc_info, &set) == VK_SUCCESS) {
+                    deferffl([pool, set] { vkFreeDescriptorSets(device, pool, 1, &set); });
+                    return set;
+                }
+            }
+            VkDescriptorPool pool = create_pool();
+            alloc_info.descriptorPool = pool;
+            vkAllocateDescriptorSets(device, &alloc_info, &set);
+            deferffl([pool, set] { vkFreeDescriptorSets(device, pool, 1, &set); });
+            return set;
+        }
+
+        // usage narrows the view to what its format supports, an sRGB image only stores through its UNORM views
+        VkImageView level_view(const EngineImage &image, VkFormat format, uint32_t level, VkImageUsageFlags usage) {
+            VkImageViewUsageCreateInfo usage_info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO,
+                .usage = usage,
+            };
+            VkImageViewCreateInfo view_info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .pNext = &usage_info,
+                .image = image.deviceImage,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = format,
+                .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1},
+            };
+            VkImageView view;
+            vkCreateImageView(device, &view_info, g_vk_Allocator, &view);
+            defer_destroy_image_view(view);
+            return view;
+        }
+
+        void generate_blit(VkCommandBuffer cb, EngineImage &image) {
+            // level 0 was written by the staging copy, the rest is written from scratch
+            image.transition(batch, ImageAccess::BlitSrc, 0, 1);
+            image.transition(batch, ImageAccess::BlitDst, 1, -1);
+            batch.flush(cb);
+            int32_t w = (int32_t)image.width, h = (int32_t)image.height;
+            for (uint32_t level = 1; level < image.mipcount; level++) {
+                // written by the previous blit
+                if (level > 1)
+                    image.transition(cb, ImageAccess::BlitSrc, level - 1, 1);
+                const int32_t nw = std::max(w / 2, 1), nh = std::max(h / 2, 1);
+                VkImageBlit blit = {
+                    .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1},
+                    .srcOffsets = {{0, 0, 0}, {w, h, 1}},
+                    .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+                    .dstOffsets = {{0, 0, 0}, {nw, nh, 1}},
+                };
+                vkCmdBlitImage(cb, image.deviceImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               image.deviceImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+                w = nw;
+                h = nh;
+            }
+            // the read levels and the last, written one leave together, one barrier per differing state
+            image.transition(cb, ImageAccess::FragmentSampled);
+        }
+
+        void generate_compute(VkCommandBuffer cb, EngineImage &image) {
+            if (pipeline == VK_NULL_HANDLE)
+                create_pipeline();
+            const VkFormat write_format = storage_format(image.format);
+
+            image.transition(batch, ImageAccess::ComputeSampled, 0, 1);
+            image.transition(batch, ImageAccess::ComputeStorageWrite, 1, -1);
+            batch.flush(cb);
+            vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+            Push push = {{(int32_t)image.width, (int32_t)image.height}, image.format != write_format};
+            for (uint32_t level = 1; level < image.mipcount; level++) {
+                push.dst_size[0] = std::max(push.dst_size[0] / 2, 1);
+                push.dst_size[1] = std::max(push.dst_size[1] / 2, 1);
+
+                VkDescriptorImageInfo src = {sampler, level_view(image, image.format, level - 1, VK_IMAGE_USAGE_SAMPLED_BIT), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+                VkDescriptorImageInfo dst = {VK_NULL_HANDLE, level_view(image, write_format, level, VK_IMAGE_USAGE_STORAGE_BIT), VK_IMAGE_LAYOUT_GENERAL};
+                VkDescriptorSet set = allocate_set();
+                VkWriteDescriptorSet writes[] = {
+                    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 0, .descriptorCount = 1,
+                     .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &src},
+                    {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = set, .dstBinding = 1, .descriptorCount = 1,
+                     .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &dst},
+                };
+                vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+
+                vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+                vkCmdPushConstants(cb, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Push), &push);
+                vkCmdDispatch(cb, (push.dst_size[0] + 7) / 8, (push.dst_size[1] + 7) / 8, 1);
+
+                image.transition(cb, ImageAccess::ComputeSampled, level, 1);
+            }
+            // every level is sampled by compute now, one barrier hands the chain to the fragment stage
+            image.transition(cb, ImageAccess::FragmentSampled);
+        }
+    }
+
+    bool supports_blit(VkFormat format) {
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(g_PhysicalDevice, format, &properties);
+        const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                            VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & needed) == needed;
+    }
+    VkImageUsageFlags required_usage(VkFormat format) {
+        if (supports_blit(format))
+            return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        if (storage_format(format) != VK_FORMAT_UNDEFINED)
+            return VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        return 0;
+    }
+    VkImageCreateFlags required_flags(VkFormat format) {
+        // sRGB formats can't be storage images, the usage is only valid on the image because its views narrow it
+        if (!supports_blit(format) && storage_format(format) != VK_FORMAT_UNDEFINED && storage_format(format) != format)
+            return VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+        return 0;
+    }
+    VkImageUsageFlags view_usage(VkFormat format, VkImageUsageFlags usage) {
+        return storage_format(format) != format ? usage & ~VK_IMAGE_USAGE_STORAGE_BIT : usage;
+    }
+
+    void shutdown() {
+        for (VkDescriptorPool pool : pools)
+            vkDestroyDescriptorPool(device, pool, g_vk_Allocator);
+        pools.clear();
+        if (pipeline == VK_NULL_HANDLE)
+            return;
+        vkDestroyPipeline(device, pipeline, g_vk_Allocator);
+        vkDestroyPipelineLayout(device, pipelineLayout, g_vk_Allocator);
+        vkDestroyDescriptorSetLayout(device, setLayout, g_vk_Allocator);
+        vkDestroySampler(device, sampler, g_vk_Allocator);
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    void generate(VkCommandBuffer cb, EngineImage &image) {
+        if (image.mipcount > 1 && supports_blit(image.format)) {
+            generate_blit(cb, image);
+        } else if (image.mipcount > 1 && storage_format(image.format) != VK_FORMAT_UNDEFINED) {
+            generate_compute(cb, image);
+        } else {
+            if (image.mipcount > 1)
+                SDL_Log("[mips] Warning: no mip generation path for format %d, only level 0 is valid", image.format);
+            image.transition(cb, ImageAccess::FragmentSampled);
+        }
+    }
+}
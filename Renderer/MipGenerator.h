@@ -0,0 +1,25 @@
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+#include <volk.h>
+
+class EngineImage;
+
+/**
+ * Fills an image's mip chain from level 0. Uses a vkCmdBlitImage cascade when the format supports linear
+ * blits and a compute downsample otherwise, which needs the image created with required_usage() and
+ * required_flags().
+ */
+namespace renderer::mips {
+    bool supports_blit(VkFormat format);
+    VkImageUsageFlags required_usage(VkFormat format);
+    VkImageCreateFlags required_flags(VkFormat format);
+    /// usage for views of the image in its own format, the storage usage of the compute path stays on its UNORM views
+    VkImageUsageFlags view_usage(VkFormat format, VkImageUsageFlags usage);
+
+    void shutdown();
+    /**
+     * @param image level 0 written by a copy, the other levels are overwritten, ends in SHADER_READ_ONLY_OPTIMAL
+     */
+    void generate(VkCommandBuffer cb, EngineImage &image);
+}
+#endif //MIPGENERATOR_H
@@ -0,0 +1,83 @@
+#include "ParallelRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "ResourceManager.h"
+#include "../love_worker_pool.h"
+
+namespace renderer::parallel {
+    static std::unique_ptr<WorkerPool> workers;
+    static std::vector<VkCommandBuffer> secondaries;
+    static RecordStats stats = {};
+
+    void init(uint32_t threads) {
+        workers = std::make_unique<WorkerPool>(threads ? threads : WorkerPool::default_thread_count());
+    }
+    void shutdown() {
+        workers.reset();
+        secondaries.clear();
+    }
+    uint32_t thread_count() {
+        return workers ? workers->size() : 0;
+    }
+
+    static void record_jobs(VkCommandBuffer primary, const VkCommandBufferBeginInfo &begin_info, uint32_t count,
+                            const std::function<void(VkCommandBuffer cb, uint32_t job)> &fn) {
+        if (count == 0) return;
+        const auto start = std::chrono::steady_clock::now();
+        secondaries.resize(count);
+
+        workers->parallel_for(count, [&](uint32_t job, uint32_t worker) {
+            VkCommandBuffer cb = make_secondary_cb_for_frame(worker);
+            vkBeginCommandBuffer(cb, &begin_info);
+            fn(cb, job);
+            vkEndCommandBuffer(cb);
+            secondaries[job] = cb;
+        });
+        vkCmdExecuteCommands(primary, count, secondaries.data());
+
+        stats = {
+            .jobs = count,
+            .threads = std::min(count, workers->size()),
+            .record_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count(),
+        };
+    }
+
+    void record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo &inheritance, uint32_t count,
+                const std::function<void(VkCommandBuffer cb, uint32_t job)> &fn) {
+        VkCommandBufferInheritanceInfo inherit = inheritance;
+        inherit.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        VkCommandBufferBeginInfo begin_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            .pInheritanceInfo = &inherit,
+        };
+        if (inherit.renderPass != VK_NULL_HANDLE)
+            begin_info.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        record_jobs(primary, begin_info, count, fn);
+    }
+
+    void record(VkCommandBuffer primary, const VkCommandBufferInheritanceRenderingInfo &rendering, uint32_t count,
+                const std::function<void(VkCommandBuffer cb, uint32_t job)> &fn) {
+        // dynamic rendering has no render pass to name, the formats and flags come through the pNext chain
+        VkCommandBufferInheritanceRenderingInfo inherit_rendering = rendering;
+        inherit_rendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+        inherit_rendering.pNext = nullptr;
+        VkCommandBufferInheritanceInfo inherit = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = &inherit_rendering,
+        };
+        VkCommandBufferBeginInfo begin_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+            .pInheritanceInfo = &inherit,
+        };
+        record_jobs(primary, begin_info, count, fn);
+    }
+
+    RecordStats last_stats() {
+        return stats;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef PARALLELRECORDER_H
+#define PARALLELRECORDER_H
+#include <cstdint>
+#include <functional>
+#include <volk.h>
+
+/**
+ * Parallel command recording. Jobs are recorded into secondary command buffers on worker threads, each
+ * worker allocating from its own per-frame pool (see make_secondary_cb_for_frame), and then executed into
+ * the primary buffer in job order so the result does not depend on scheduling.
+ */
+namespace renderer::parallel {
+    struct RecordStats {
+        uint32_t jobs;
+        uint32_t threads;
+        float record_ms; // wall time of the last record() call, recording included
+    };
+
+    /// starts the recording threads, call before init_frame_resource_manager(thread_count())
+    void init(uint32_t threads = 0);
+    void shutdown();
+    uint32_t thread_count();
+
+    /**
+     * @param primary command buffer the secondaries are executed into, if inheritance names a render pass
+     * it must have been begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+     * @param fn records job into cb, called concurrently from the workers
+     */
+    void record(VkCommandBuffer primary, const VkCommandBufferInheritanceInfo &inheritance, uint32_t count,
+                const std::function<void(VkCommandBuffer cb, uint32_t job)> &fn);
+    /**
+     * same inside a dynamic rendering scope
+     * @param rendering formats of the scope primary is in, which must have been begun with
+     * VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, e.g. graph::rendering_inheritance() in a graph pass
+     * marked with graph::secondaries()
+     */
+    void record(VkCommandBuffer primary, const VkCommandBufferInheritanceRenderingInfo &rendering, uint32_t count,
+                const std::function<void(VkCommandBuffer cb, uint32_t job)> &fn);
+    RecordStats last_stats();
+}
+#endif //PARALLELRECORDER_H
@@ -0,0 +1,192 @@
+#include "PipelineCache.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+
+#include "Renderer.h"
+#include "renderer_constants.h"
+
+namespace renderer::pipeline_cache {
+    namespace {
+        // ours, in front of the driver's blob
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t data_size;
+            uint8_t driver_uuid[VK_UUID_SIZE];
+            float cold_startup_ms;
+            uint32_t reserved;
+        };
+        constexpr uint32_t file_magic = 0x4350564c; // "LVPC"
+        constexpr uint32_t file_version = 1;
+
+        std::string path;
+        VkPhysicalDeviceProperties properties;
+        uint8_t driverUuid[VK_UUID_SIZE];
+        size_t savedSize = 0;
+        CacheStats cacheStats = {};
+        std::chrono::steady_clock::time_point lastSave;
+
+        std::string cache_path() {
+            char *pref = SDL_GetPrefPath("Love", "LoveEngine");
+            if (!pref) {
+                SDL_Log("[pipeline cache] Warning: no pref path, the cache is not persisted: %s", SDL_GetError());
+                return {};
+            }
+            std::string result = std::string(pref) + "pipeline_cache.bin";
+            SDL_free(pref);
+            return result;
+        }
+
+        bool read_file(std::vector<uint8_t> &data, FileHeader &header) {
+            FILE *file = fopen(path.c_str(), "rb");
+            if (!file)
+                return false;
+            bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == file_magic &&
+                      header.version == file_version && header.data_size < (1ull << 31);
+            if (ok) {
+                data.resize(header.data_size);
+                ok = fread(data.data(), 1, data.size(), file) == data.size();
+            }
+            fclose(file);
+            return ok;
+        }
+
+        // the driver ignores blobs it does not like too, but some crash on them
+        bool matches_device(const std::vector<uint8_t> &data, const FileHeader &header) {
+            VkPipelineCacheHeaderVersionOne vk_header;
+            if (data.size() < sizeof(vk_header))
+                return false;
+            memcpy(&vk_header, data.data(), sizeof(vk_header));
+            return vk_header.headerSize >= sizeof(vk_header) &&
+                   vk_header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                   vk_header.vendorID == properties.vendorID &&
+                   vk_header.deviceID == properties.deviceID &&
+                   memcmp(vk_header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0 &&
+                   memcmp(header.driver_uuid, driverUuid, VK_UUID_SIZE) == 0;
+        }
+    }
+
+    void init() {
+        VkPhysicalDeviceIDProperties id_properties = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES};
+        VkPhysicalDeviceProperties2 properties2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &id_properties,
+        };
+        vkGetPhysicalDeviceProperties2(g_PhysicalDevice, &properties2);
+        properties = properties2.properties;
+        memcpy(driverUuid, id_properties.driverUUID, VK_UUID_SIZE);
+
+        path = cache_path();
+        std::vector<uint8_t> data;
+        FileHeader header;
+        cacheStats = {};
+        if (!path.empty() && read_file(data, header)) {
+            if (matches_device(data, header)) {
+                cacheStats.loaded_bytes = data.size();
+                cacheStats.cold_startup_ms = header.cold_startup_ms;
+            } else {
+                SDL_Log("[pipeline cache] Discarding %s, it was written for another device or driver", path.c_str());
+                data.clear();
+            }
+        }
+
+        VkPipelineCacheCreateInfo info = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .initialDataSize = data.size(),
+            .pInitialData = data.empty() ? nullptr : data.data(),
+        };
+        if (vkCreatePipelineCache(device, &info, g_vk_Allocator, &g_PipelineCache) != VK_SUCCESS) {
+            // rejected blobs are not an error worth dying for, start empty
+            info.initialDataSize = 0;
+            info.pInitialData = nullptr;
+            cacheStats.loaded_bytes = 0;
+            vkCreatePipelineCache(device, &info, g_vk_Allocator, &g_PipelineCache);
+        }
+        savedSize = cacheStats.loaded_bytes;
+        lastSave = std::chrono::steady_clock::now();
+    }
+    void shutdown() {
+        if (g_PipelineCache == VK_NULL_HANDLE)
+            return;
+        save();
+        vkDestroyPipelineCache(device, g_PipelineCache, g_vk_Allocator);
+        g_PipelineCache = VK_NULL_HANDLE;
+    }
+
+    void update() {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastSave < std::chrono::seconds(PIPELINE_CACHE_SAVE_INTERVAL))
+            return;
+        lastSave = now;
+        size_t size = 0;
+        vkGetPipelineCacheData(device, g_PipelineCache, &size, nullptr);
+        if (size > savedSize)
+            save();
+    }
+
+    bool save() {
+        if (path.empty() || g_PipelineCache == VK_NULL_HANDLE)
+            return false;
+        size_t size = 0;
+        vkGetPipelineCacheData(device, g_PipelineCache, &size, nullptr);
+        std::vector<uint8_t> data(size);
+        if (size == 0 || vkGetPipelineCacheData(device, g_PipelineCache, &size, data.data()) != VK_SUCCESS)
+            return false;
+        data.resize(size);
+
+        FileHeader header = {
+            .magic = file_magic,
+            .version = file_version,
+            .data_size = size,
+            .cold_startup_ms = cacheStats.cold_startup_ms,
+        };
+        memcpy(header.driver_uuid, driverUuid, VK_UUID_SIZE);
+
+        // written next to the target and renamed over it, a crash mid-write never leaves a torn cache behind
+        const std::string temp = path + ".tmp";
+        FILE *file = fopen(temp.c_str(), "wb");
+        if (!file) {
+            SDL_Log("[pipeline cache] Warning: could not write %s", temp.c_str());
+            return false;
+        }
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data.data(), 1, size, file) == size;
+        ok = fflush(file) == 0 && ok;
+        ok = fclose(file) == 0 && ok;
+        std::error_code error;
+        if (ok)
+            std::filesystem::rename(temp, path, error);
+        if (!ok || error) {
+            SDL_Log("[pipeline cache] Warning: could not save %s", path.c_str());
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+        savedSize = size;
+        cacheStats.saved_bytes = size;
+        return true;
+    }
+
+    void record_startup(float pipeline_ms) {
+        cacheStats.startup_ms = pipeline_ms;
+        if (cacheStats.loaded_bytes == 0) {
+            cacheStats.cold_startup_ms = pipeline_ms;
+            SDL_Log("[pipeline cache] Cold start, startup pipelines took %.2f ms", pipeline_ms);
+        } else if (cacheStats.cold_startup_ms > 0) {
+            SDL_Log("[pipeline cache] Loaded %zu bytes, startup pipelines took %.2f ms, %.2f ms less than the cold start",
+                    cacheStats.loaded_bytes, pipeline_ms, cacheStats.cold_startup_ms - pipeline_ms);
+        } else {
+            SDL_Log("[pipeline cache] Loaded %zu bytes, startup pipelines took %.2f ms", cacheStats.loaded_bytes, pipeline_ms);
+        }
+    }
+
+    CacheStats stats() {
+        return cacheStats;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef PIPELINECACHE_H
+#define PIPELINECACHE_H
+#include <cstddef>
+#include <volk.h>
+
+/**
+ * Owns renderer::g_PipelineCache. The cache is seeded from a blob in the SDL pref path when its header
+ * matches this device (vendor, device and pipelineCacheUUID) and written back atomically, on shutdown
+ * and every PIPELINE_CACHE_SAVE_INTERVAL seconds once new pipelines made it grow.
+ */
+namespace renderer::pipeline_cache {
+    /// creates g_PipelineCache, called by SetupVulkan once the device exists
+    void init();
+    /// saves and destroys the cache, call before the device is destroyed
+    void shutdown();
+    /// saves if the interval passed and the cache grew since the last save, once per frame
+    void update();
+    bool save();
+
+    /**
+     * startup pipeline creation time, stored with the blob of a cold start so warm starts can report the difference
+     * @param pipeline_ms time spent creating the startup pipelines
+     */
+    void record_startup(float pipeline_ms);
+
+    struct CacheStats {
+        size_t loaded_bytes;    // 0 on a cold start or when the blob was rejected
+        size_t saved_bytes;     // size of the last blob written
+        float startup_ms;       // this launch's startup pipeline time
+        float cold_startup_ms;  // the same on the launch that created the blob, 0 if unknown
+    };
+    CacheStats stats();
+}
+#endif //PIPELINECACHE_H
@@ -0,0 +1,529 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <vector>
+#include <SDL3/SDL_log.h>
+#include <vk_mem_alloc.h>
+
+#include "GpuProfiler.h"
+#include "GpuTimeline.h"
+#include "Renderer.h"
+#include "ResourceManager.h"
+#include "renderer_constants.h"
+#include "../debug_panic.h"
+
+namespace renderer::graph {
+    using barriers::ImageAccess;
+
+    namespace {
+        constexpr uint32_t none = UINT32_MAX;
+
+        struct ResourceNode {
+            const char *name;
+            bool imported;
+            VkImage image;
+            VkImageView view;
+            ImageDesc desc;
+            VkImageUsageFlags usage;        // transients, collected from the passes
+            barriers::SubresourceState state;
+            ImageAccess final_access;       // imported
+            uint32_t first_pass, last_pass; // live passes using a transient, in execution order
+            uint32_t block;
+        };
+        struct Attachment {
+            Resource resource;
+            VkAttachmentLoadOp load;
+            VkClearColorValue clear;
+        };
+        struct ResourceUse {
+            Resource resource;
+            ImageAccess access;
+        };
+        struct PassNode {
+            const char *name;
+            PassFn fn;
+            std::vector<Attachment> colors;
+            std::vector<ResourceUse> uses;
+            bool side_effect;
+            bool secondary;     // fn only executes secondary command buffers
+            bool live;
+        };
+
+        // one frame slot's transients, reused as long as the graph declares the same ones
+        struct TransientImage {
+            VkImage image;
+            VkImageView view;
+        };
+        struct TransientSet {
+            uint64_t signature = 0;
+            std::vector<TransientImage> images;
+            std::vector<VmaAllocation> blocks;
+            std::vector<uint32_t> image_block;  // per image
+            std::vector<barriers::SubresourceState> handoffs; // per block, last resident's final state this frame
+            VkDeviceSize transient_bytes = 0;
+            VkDeviceSize allocated_bytes = 0;
+            uint64_t value = 0;             // timeline value of the last frame that used them
+        };
+        struct Block {
+            VkMemoryRequirements requirements;
+            std::vector<std::pair<uint32_t, uint32_t>> lifetimes;
+        };
+
+        std::vector<ResourceNode> resources;
+        std::vector<PassNode> passes;
+        uint32_t passCount = 0;
+        std::vector<Block> blocks;          // build_transients scratch
+        std::vector<uint32_t> transientOrder;
+        TransientSet transientSets[MAX_INFLIGHT_FRAMES];
+        uint32_t slot = 0;
+        barriers::BarrierBatch batch;
+        std::vector<VkRenderingAttachmentInfo> renderingAttachments;
+        std::vector<VkFormat> renderingFormats;
+        VkCommandBufferInheritanceRenderingInfo renderingInheritance = {};
+        GraphStats lastStats = {};
+        uint32_t rebuilds = 0;
+
+        bool writes(ImageAccess access) {
+            switch (access) {
+                case ImageAccess::CopyDst:
+                case ImageAccess::BlitDst:
+                case ImageAccess::ComputeStorageWrite:
+                case ImageAccess::ColorAttachment:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        VkImageUsageFlags usage_for(ImageAccess access) {
+            switch (access) {
+                case ImageAccess::CopyDst:
+                case ImageAccess::BlitDst:
+                    return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                case ImageAccess::CopySrc:
+                case ImageAccess::BlitSrc:
+                    return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                case ImageAccess::ComputeSampled:
+                case ImageAccess::FragmentSampled:
+                    return VK_IMAGE_USAGE_SAMPLED_BIT;
+                case ImageAccess::ComputeStorageWrite:
+                    return VK_IMAGE_USAGE_STORAGE_BIT;
+                case ImageAccess::ColorAttachment:
+                    return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                default:
+                    return 0;
+            }
+        }
+
+        void check(VkResult err, const char *what) {
+            if (err == VK_SUCCESS)
+                return;
+            SDL_Log("[graph] Error: %s failed with VkResult %d", what, err);
+            panic();
+        }
+
+        uint64_t hash(uint64_t h, uint64_t value) {
+            return (h ^ value) * 0x100000001b3ull;
+        }
+
+        /**
+         * a pass stays if it has side effects, writes an imported image or writes something a live pass reads.
+         * Passes were added in execution order, so walking them backwards sees every reader before its writers.
+         */
+        void cull() {
+            std::vector<bool> needed(resources.size(), false);
+            for (uint32_t p = passCount; p-- > 0;) {
+                PassNode &pass = passes[p];
+                pass.live = pass.side_effect;
+                for (const auto &color : pass.colors)
+                    pass.live |= resources[color.resource].imported || needed[color.resource];
+                for (const auto &use : pass.uses)
+                    if (writes(use.access))
+                        pass.live |= resources[use.resource].imported || needed[use.resource];
+                if (!pass.live)
+                    continue;
+                // what a live pass loads or reads has to be produced by someone earlier
+                for (const auto &color : pass.colors)
+                    if (color.load == VK_ATTACHMENT_LOAD_OP_LOAD)
+                        needed[color.resource] = true;
+                for (const auto &use : pass.uses)
+                    if (!writes(use.access))
+                        needed[use.resource] = true;
+            }
+        }
+
+        void touch(Resource id, uint32_t order, VkImageUsageFlags usage) {
+            ResourceNode &resource = resources[id];
+            if (resource.imported)
+                return;
+            resource.first_pass = std::min(resource.first_pass, order);
+            resource.last_pass = order;
+            resource.usage |= usage;
+        }
+
+        bool overlaps(const Block &block, uint32_t first, uint32_t last) {
+            for (auto [f, l] : block.lifetimes)
+                if (first <= l && f <= last)
+                    return true;
+            return false;
+        }
+
+        void destroy_set(TransientSet &set) {
+            for (auto &image : set.images) {
+                defer_destroy_image_view(image.view);
+                defer_destroy_image(image.image);
+            }
+            for (VmaAllocation block : set.blocks)
+                defer_free_allocation(block);
+            set = {};
+        }
+
+        /**
+         * creates the transients and packs them into blocks, largest first, each into the first block whose residents
+         * are all dead before it starts or born after it ends
+         */
+        void build_transients(TransientSet &set, uint64_t signature) {
+            destroy_set(set);
+            set.signature = signature;
+            std::vector<VkMemoryRequirements> requirements(transientOrder.size());
+            set.images.resize(transientOrder.size());
+            for (uint32_t i = 0; i < transientOrder.size(); i++) {
+                const ResourceNode &resource = resources[transientOrder[i]];
+                VkImageCreateInfo info = {
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+                    .imageType = VK_IMAGE_TYPE_2D,
+                    .format = resource.desc.format,
+                    .extent = {resource.desc.width, resource.desc.height, 1},
+                    .mipLevels = 1,
+                    .arrayLayers = 1,
+                    .samples = VK_SAMPLE_COUNT_1_BIT,
+                    .tiling = VK_IMAGE_TILING_OPTIMAL,
+                    .usage = resource.usage,
+                    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                };
+                check(vkCreateImage(device, &info, g_vk_Allocator, &set.images[i].image), "vkCreateImage");
+                vkGetImageMemoryRequirements(device, set.images[i].image, &requirements[i]);
+                set.transient_bytes += requirements[i].size;
+            }
+
+            std::vector<uint32_t> by_size(transientOrder.size());
+            for (uint32_t i = 0; i < by_size.size(); i++)
+                by_size[i] = i;
+            std::stable_sort(by_size.begin(), by_size.end(),
+                             [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+            blocks.clear();
+            set.image_block.resize(transientOrder.size());
+            for (uint32_t i : by_size) {
+                const ResourceNode &resource = resources[transientOrder[i]];
+                uint32_t b = 0;
+                for (; b < blocks.size(); b++)
+                    if ((blocks[b].requirements.memoryTypeBits & requirements[i].memoryTypeBits) != 0 &&
+                        !overlaps(blocks[b], resource.first_pass, resource.last_pass))
+                        break;
+                if (b == blocks.size())
+                    blocks.push_back({requirements[i], {}});
+                Block &block = blocks[b];
+                block.requirements.size = std::max(block.requirements.size, requirements[i].size);
+                block.requirements.alignment = std::max(block.requirements.alignment, requirements[i].alignment);
+                block.requirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+                block.lifetimes.emplace_back(resource.first_pass, resource.last_pass);
+                set.image_block[i] = b;
+            }
+
+            set.blocks.resize(blocks.size());
+            VmaAllocationCreateInfo alloc_info = {
+                .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            };
+            for (uint32_t b = 0; b < blocks.size(); b++) {
+                check(vmaAllocateMemory(vma_allocator, &blocks[b].requirements, &alloc_info, &set.blocks[b], nullptr),
+                      "vmaAllocateMemory");
+                set.allocated_bytes += blocks[b].requirements.size;
+            }
+            for (uint32_t i = 0; i < transientOrder.size(); i++) {
+                const ResourceNode &resource = resources[transientOrder[i]];
+                check(vmaBindImageMemory(vma_allocator, set.blocks[set.image_block[i]], set.images[i].image), "vmaBindImageMemory");
+                VkImageViewCreateInfo view_info = {
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                    .image = set.images[i].image,
+                    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                    .format = resource.desc.format,
+                    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+                };
+                check(vkCreateImageView(device, &view_info, g_vk_Allocator, &set.images[i].view), "vkCreateImageView");
+            }
+            rebuilds++;
+        }
+
+        /// lifetimes, then the slot's images, rebuilt only when a description, usage or lifetime changed
+        void realize_transients() {
+            transientOrder.clear();
+            uint64_t signature = 0xcbf29ce484222325ull;
+            for (Resource id = 0; id < resources.size(); id++) {
+                const ResourceNode &resource = resources[id];
+                if (resource.imported || resource.first_pass == none)
+                    continue;
+                transientOrder.push_back(id);
+                signature = hash(signature, resource.desc.width | (uint64_t)resource.desc.height << 32);
+                signature = hash(signature, resource.desc.format | (uint64_t)resource.usage << 32);
+                signature = hash(signature, resource.first_pass | (uint64_t)resource.last_pass << 32);
+            }
+            TransientSet &set = transientSets[slot];
+            // pacing keeps frames in flight below the slot count, this only waits if something submitted out of band
+            timeline::wait(set.value);
+            if (transientOrder.empty()) {
+                if (set.signature != 0)
+                    destroy_set(set);
+                return;
+            }
+            if (set.signature != signature)
+                build_transients(set, signature);
+            // the previous frame in this slot finished, every block starts out unused
+            set.handoffs.assign(set.blocks.size(), {});
+            for (uint32_t i = 0; i < transientOrder.size(); i++) {
+                ResourceNode &resource = resources[transientOrder[i]];
+                resource.image = set.images[i].image;
+                resource.view = set.images[i].view;
+                resource.block = set.image_block[i];
+            }
+        }
+
+        // a transient's first use waits on whatever used its memory before it, with its contents undefined
+        void acquire_memory(ResourceNode &resource, uint32_t order) {
+            if (resource.imported || resource.first_pass != order)
+                return;
+            resource.state = transientSets[slot].handoffs[resource.block];
+            resource.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+
+        void release_memory(const ResourceNode &resource, uint32_t order) {
+            if (!resource.imported && resource.last_pass == order)
+                transientSets[slot].handoffs[resource.block] = resource.state;
+        }
+
+        // consecutive passes on the same attachments that keep their contents share the rendering scope
+        bool continues_rendering(const PassNode &previous, const PassNode &pass) {
+            if (pass.colors.empty() || !pass.uses.empty() || pass.secondary || pass.colors.size() != previous.colors.size())
+                return false;
+            for (size_t i = 0; i < pass.colors.size(); i++)
+                if (pass.colors[i].resource != previous.colors[i].resource || pass.colors[i].load != VK_ATTACHMENT_LOAD_OP_LOAD)
+                    return false;
+            return true;
+        }
+
+        void begin_rendering(VkCommandBuffer cb, const PassNode &pass) {
+            renderingAttachments.clear();
+            renderingFormats.clear();
+            uint32_t width = UINT32_MAX, height = UINT32_MAX;
+            for (const auto &color : pass.colors) {
+                const ResourceNode &resource = resources[color.resource];
+                VkRenderingAttachmentInfo attachment = {
+                    .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                    .imageView = resource.view,
+                    .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                    .loadOp = color.load,
+                    .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                };
+                attachment.clearValue.color = color.clear;
+                renderingAttachments.push_back(attachment);
+                renderingFormats.push_back(resource.desc.format);
+                width = std::min(width, resource.desc.width);
+                height = std::min(height, resource.desc.height);
+            }
+            VkRenderingInfo info = {
+                .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+                .flags = pass.secondary ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT : 0u,
+                .renderArea = {{0, 0}, {width, height}},
+                .layerCount = 1,
+                .colorAttachmentCount = (uint32_t)renderingAttachments.size(),
+                .pColorAttachments = renderingAttachments.data(),
+            };
+            vkCmdBeginRenderingKHR(cb, &info);
+            // flags match the scope's apart from the contents bit
+            renderingInheritance = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+                .colorAttachmentCount = (uint32_t)renderingFormats.size(),
+                .pColorAttachmentFormats = renderingFormats.data(),
+                .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+            };
+        }
+    }
+
+    void shutdown() {
+        for (auto &set : transientSets) {
+            for (auto &image : set.images) {
+                vkDestroyImageView(device, image.view, g_vk_Allocator);
+                vkDestroyImage(device, image.image, g_vk_Allocator);
+            }
+            for (VmaAllocation block : set.blocks)
+                vmaFreeMemory(vma_allocator, block);
+            set = {};
+        }
+        resources.clear();
+        passes.clear();
+        passCount = 0;
+    }
+
+    void begin() {
+        resources.clear();
+        passCount = 0;
+    }
+
+    Resource import_image(const char *name, VkImage image, VkImageView view, const ImageDesc &desc,
+                          const barriers::SubresourceState &initial, ImageAccess final_access) {
+        resources.push_back({
+            .name = name,
+            .imported = true,
+            .image = image,
+            .view = view,
+            .desc = desc,
+            .usage = 0,
+            .state = initial,
+            .final_access = final_access,
+            .first_pass = none,
+            .last_pass = none,
+            .block = none,
+        });
+        return (Resource)resources.size() - 1;
+    }
+
+    Resource create_image(const char *name, const ImageDesc &desc) {
+        resources.push_back({
+            .name = name,
+            .imported = false,
+            .image = VK_NULL_HANDLE,
+            .view = VK_NULL_HANDLE,
+            .desc = desc,
+            .usage = 0,
+            .state = {},
+            .final_access = ImageAccess::Undefined,
+            .first_pass = none,
+            .last_pass = none,
+            .block = none,
+        });
+        return (Resource)resources.size() - 1;
+    }
+
+    Pass add_pass(const char *name, PassFn fn) {
+        if (passCount == passes.size())
+            passes.emplace_back();
+        PassNode &pass = passes[passCount];
+        pass.name = name;
+        pass.fn = std::move(fn);
+        pass.colors.clear();
+        pass.uses.clear();
+        pass.side_effect = false;
+        pass.secondary = false;
+        pass.live = false;
+        return passCount++;
+    }
+
+    void color(Pass pass, Resource image, VkAttachmentLoadOp load, VkClearColorValue clear) {
+        passes[pass].colors.push_back({image, load, clear});
+    }
+
+    void use(Pass pass, Resource image, ImageAccess access) {
+        passes[pass].uses.push_back({image, access});
+    }
+
+    void side_effect(Pass pass) {
+        passes[pass].side_effect = true;
+    }
+
+    void secondaries(Pass pass) {
+        passes[pass].secondary = true;
+    }
+
+    const VkCommandBufferInheritanceRenderingInfo &rendering_inheritance() {
+        return renderingInheritance;
+    }
+
+    void execute(VkCommandBuffer cb) {
+        GraphStats frame = {.passes = passCount};
+        cull();
+
+        // lifetimes in execution order over the live passes only
+        uint32_t order = 0;
+        for (uint32_t p = 0; p < passCount; p++) {
+            const PassNode &pass = passes[p];
+            if (!pass.live) {
+                frame.culled++;
+                continue;
+            }
+            for (const auto &color : pass.colors)
+                touch(color.resource, order, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+            for (const auto &use : pass.uses)
+                touch(use.resource, order, usage_for(use.access));
+            order++;
+        }
+        realize_transients();
+
+        const PassNode *rendering = nullptr;
+        order = 0;
+        for (uint32_t p = 0; p < passCount; p++) {
+            PassNode &pass = passes[p];
+            if (!pass.live)
+                continue;
+            const bool merge = rendering && continues_rendering(*rendering, pass);
+            if (merge) {
+                frame.merged++;
+            } else {
+                if (rendering)
+                    vkCmdEndRenderingKHR(cb);
+                rendering = nullptr;
+                for (const auto &use : pass.uses) {
+                    ResourceNode &resource = resources[use.resource];
+                    acquire_memory(resource, order);
+                    batch.transition(resource.image, &resource.state, 0, 1, use.access);
+                }
+                for (const auto &color : pass.colors) {
+                    ResourceNode &resource = resources[color.resource];
+                    acquire_memory(resource, order);
+                    batch.transition(resource.image, &resource.state, 0, 1, ImageAccess::ColorAttachment);
+                }
+                batch.flush(cb);
+            }
+            if (pass.secondary && !pass.colors.empty()) {
+                // a scope of secondaries takes no timestamps from the primary, the zone goes around it
+                const uint32_t zone = gpu_profiler::begin_zone(cb, pass.name);
+                begin_rendering(cb, pass);
+                pass.fn(cb);
+                vkCmdEndRenderingKHR(cb);
+                gpu_profiler::end_zone(cb, zone);
+            } else {
+                if (!merge && !pass.colors.empty()) {
+                    begin_rendering(cb, pass);
+                    rendering = &pass;
+                }
+                gpu_profiler::Zone zone(cb, pass.name);
+                pass.fn(cb);
+            }
+            for (const auto &use : pass.uses)
+                release_memory(resources[use.resource], order);
+            for (const auto &color : pass.colors)
+                release_memory(resources[color.resource], order);
+            order++;
+        }
+        if (rendering)
+            vkCmdEndRenderingKHR(cb);
+
+        // imported images leave in one barrier
+        for (auto &resource : resources)
+            if (resource.imported)
+                batch.transition(resource.image, &resource.state, 0, 1, resource.final_access);
+        batch.flush(cb);
+
+        TransientSet &set = transientSets[slot];
+        set.value = timeline::pending_value();
+        slot = (slot + 1) % MAX_INFLIGHT_FRAMES;
+        frame.transients = (uint32_t)transientOrder.size();
+        frame.transient_bytes = set.transient_bytes;
+        frame.allocated_bytes = set.allocated_bytes;
+        // read after realize_transients(), which counts this frame's rebuild
+        frame.rebuilds = rebuilds;
+        lastStats = frame;
+    }
+
+    GraphStats stats() {
+        return lastStats;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+#include <cstdint>
+#include <functional>
+#include <volk.h>
+
+#include "Barriers.h"
+
+/**
+ * Per-frame render graph. Passes are added in execution order and declare the images they render to and
+ * otherwise access, execute() then culls passes whose writes nobody consumes, records the barriers between
+ * passes through the barriers tracker, and runs consecutive passes that load the same color attachments inside
+ * one dynamic rendering scope. Every pass gets a GPU profiler zone under its name. Passes marked with secondaries()
+ * get a scope of their own that only takes secondary command buffers, e.g. from parallel::record.
+ *
+ * Transient images only live within the graph. Images whose pass ranges do not overlap share one VMA block,
+ * the block set is built once per frame slot and rebuilt only when the transient descriptions change.
+ */
+namespace renderer::graph {
+    using Resource = uint32_t;
+    using Pass = uint32_t;
+    using PassFn = std::function<void(VkCommandBuffer cb)>;
+
+    struct ImageDesc {
+        uint32_t width, height;
+        VkFormat format;
+    };
+
+    /// device must be idle
+    void shutdown();
+
+    /// starts building this frame's graph, the previous one is dropped
+    void begin();
+    /**
+     * an image owned elsewhere, e.g. the swapchain image, passes writing it are never culled
+     * @param initial state when the graph starts, e.g. a layout of UNDEFINED and the stage the acquire waits on
+     * @param final_access transition recorded after the last pass
+     */
+    Resource import_image(const char *name, VkImage image, VkImageView view, const ImageDesc &desc,
+                          const barriers::SubresourceState &initial, barriers::ImageAccess final_access);
+    /// an image that only exists during the graph, its contents start undefined, usage follows from the passes
+    Resource create_image(const char *name, const ImageDesc &desc);
+    /// @param name string literal or otherwise static, also names the pass's GPU profiler zone
+    Pass add_pass(const char *name, PassFn fn);
+    /// renders to image as color attachment n in declaration order, fn runs inside the rendering scope
+    void color(Pass pass, Resource image, VkAttachmentLoadOp load, VkClearColorValue clear = {});
+    /// any other access, e.g. FragmentSampled to read an earlier pass's output
+    void use(Pass pass, Resource image, barriers::ImageAccess access);
+    /// keeps the pass even if nothing reads what it writes
+    void side_effect(Pass pass);
+    /**
+     * fn only executes secondary command buffers, its rendering scope is begun with
+     * VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT and never shared with other passes
+     */
+    void secondaries(Pass pass);
+    /// attachment formats of the running pass's rendering scope, what secondaries recorded for it inherit
+    const VkCommandBufferInheritanceRenderingInfo &rendering_inheritance();
+    /// records the live passes into cb, which must be outside a render pass
+    void execute(VkCommandBuffer cb);
+
+    struct GraphStats {
+        uint32_t passes;            // added last frame
+        uint32_t culled;
+        uint32_t merged;            // passes that continued the previous pass's rendering scope
+        uint32_t transients;
+        VkDeviceSize transient_bytes;   // what the transients would take unaliased
+        VkDeviceSize allocated_bytes;   // what their blocks take
+        uint32_t rebuilds;          // transient block sets built since startup
+    };
+    /// the last executed frame, transient_bytes - allocated_bytes is what aliasing saved
+    GraphStats stats();
+}
+#endif //RENDERGRAPH_H
@@ -7,13 +7,17 @@
 #include <SDL3/SDL_vulkan.h>
 #include <vk_mem_alloc.h>
 
+#include "Bindless.h"
+#include "GpuTimeline.h"
+#include "PipelineCache.h"
+#include "Swapchain.h"
+#include "renderer_constants.h"
 #include "../debug_panic.h"
 #ifdef _DEBUG
 #define APP_USE_VULKAN_DEBUG_REPORT
 #endif
 namespace renderer {
     static void SetupVulkan(ImVector<const char*> instance_extensions);
-    static void SetupVulkanWindow(ImGui_ImplVulkanH_Window* wd, VkSurfaceKHR surface, int width, int height);
     static void vma_init();
 #ifdef APP_USE_VULKAN_DEBUG_REPORT
     static VKAPI_ATTR VkBool32 VKAPI_CALL debug_report(VkDebugReportFlagsEXT flags, VkDebugReportObjectTypeEXT objectType, uint64_t object, size_t location, int32_t messageCode, const char* pLayerPrefix, const char* pMessage, void* pUserData)
@@ -31,6 +35,11 @@ namespace renderer {
 #endif // APP_USE_VULKAN_DEBUG_REPORT
 void init() {
     device = VK_NULL_HANDLE;
+    if (g_Headless) {
+        // no SDL video, surface or swapchain, frames are drawn into renderer::headless targets
+        SetupVulkan(ImVector<const char*>());
+        return;
+    }
     // Create window with Vulkan graphics context
     SDL_WindowFlags window_flags = (SDL_WindowFlags)(SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_HIGH_PIXEL_DENSITY | SDL_WINDOW_HIDDEN);
 
@@ -69,11 +78,10 @@ void init() {
         panic();
     }
 
-    // Create Framebuffers
+    // Create the swapchain
     int w, h;
-    SDL_GetWindowSize(window, &w, &h);
-    imgui::wd = &renderer::imgui::imgui_MainWindowData;
-    SetupVulkanWindow(imgui::wd, surface, w, h);
+    SDL_GetWindowSizeInPixels(window, &w, &h);
+    swapchain::init(surface, (uint32_t)w, (uint32_t)h);
     SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
     SDL_ShowWindow(window);
 
@@ -190,7 +198,8 @@ void SetupVulkan(ImVector<const char*> instance_extensions)
     // Select Physical Device (GPU)
     g_PhysicalDevice = SetupVulkan_SelectPhysicalDevice();
 
-    // Select graphics queue family
+    // Select graphics queue family, plus dedicated transfer and async compute families when the device has them
+    uint32_t compute_queue_index = 0;
     {
         uint32_t count;
         vkGetPhysicalDeviceQueueFamilyProperties(g_PhysicalDevice, &count, nullptr);
@@ -202,20 +211,42 @@ void SetupVulkan(ImVector<const char*> instance_extensions)
                 g_QueueFamily = i;
                 break;
             }
-        free(queues);
         IM_ASSERT(g_QueueFamily != (uint32_t)-1);
+
+        g_TransferQueueFamily = g_ComputeQueueFamily = g_QueueFamily;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const VkQueueFlags flags = queues[i].queueFlags;
+            if ((flags & VK_QUEUE_GRAPHICS_BIT) || queues[i].queueCount == 0)
+                continue;
+            if ((flags & VK_QUEUE_COMPUTE_BIT) && g_ComputeQueueFamily == g_QueueFamily)
+                g_ComputeQueueFamily = i;
+            // the staging ring copies partial row ranges, so the family has to accept any texel offset
+            const VkExtent3D granularity = queues[i].minImageTransferGranularity;
+            const bool any_offset = granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+            // a transfer-only family is the DMA engine, prefer it over sharing the compute family
+            if (any_offset && (flags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+                (g_TransferQueueFamily == g_QueueFamily || !(flags & VK_QUEUE_COMPUTE_BIT)))
+                g_TransferQueueFamily = i;
+        }
+        // transfer and compute sharing one family get a queue each when the family has two
+        if (g_ComputeQueueFamily == g_TransferQueueFamily && g_ComputeQueueFamily != g_QueueFamily &&
+            queues[g_ComputeQueueFamily].queueCount > 1)
+            compute_queue_index = 1;
+        free(queues);
+        SDL_Log("[vulkan] Queue families: graphics %u, transfer %u, compute %u", g_QueueFamily, g_TransferQueueFamily, g_ComputeQueueFamily);
     }
 
-    // Create Logical Device (with 1 queue)
+    // Create Logical Device (with 1 graphics queue and up to 2 more for transfer and compute)
     {
         ImVector<const char*> device_extensions;
-        device_extensions.push_back("VK_KHR_swapchain");
+        if (!g_Headless)
+            device_extensions.push_back("VK_KHR_swapchain");
         device_extensions.push_back("VK_KHR_dynamic_rendering");
         device_extensions.push_back("VK_KHR_synchronization2");
         device_extensions.push_back("VK_KHR_depth_stencil_resolve");
         device_extensions.push_back("VK_KHR_create_renderpass2");
-        device_extensions.push_back("VK_EXT_descriptor_indexing");
-        device_extensions.push_back("VK_KHR_buffer_device_address");
+        // descriptor indexing, buffer device address and timeline semaphores are core in 1.2 and enabled through features12
         // device_extensions.push_back("VK_EXT_swapchain_maintenance1");
         // device_extensions.push_back("VK_EXT_surface_maintenance1");
 
@@ -230,79 +261,119 @@ void SetupVulkan(ImVector<const char*> instance_extensions)
             device_extensions.push_back(VK_KHR_PORTABILITY_SUBSET_EXTENSION_NAME);
 #endif
 
-        const float queue_priority[] = { 1.0f };
-        VkDeviceQueueCreateInfo queue_info[1] = {};
-        queue_info[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queue_info[0].queueFamilyIndex = g_QueueFamily;
-        queue_info[0].queueCount = 1;
-        queue_info[0].pQueuePriorities = queue_priority;
+        VkPhysicalDeviceSynchronization2FeaturesKHR supported_sync2 = {};
+        supported_sync2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR supported_dynamic_rendering = {};
+        supported_dynamic_rendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        supported_dynamic_rendering.pNext = &supported_sync2;
+        VkPhysicalDeviceVulkan12Features supported12 = {};
+        supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        supported12.pNext = &supported_dynamic_rendering;
+        VkPhysicalDeviceFeatures2 supported = {};
+        supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported.pNext = &supported12;
+        vkGetPhysicalDeviceFeatures2(g_PhysicalDevice, &supported);
+        if (!supported12.timelineSemaphore || !supported12.bufferDeviceAddress)
+        {
+            SDL_Log("Error: device does not support timeline semaphores or buffer device address");
+            panic();
+        }
+        if (!supported_dynamic_rendering.dynamicRendering || !supported_sync2.synchronization2)
+        {
+            SDL_Log("Error: device does not support dynamic rendering or synchronization2");
+            panic();
+        }
+        if (!supported12.descriptorIndexing || !supported12.runtimeDescriptorArray || !supported12.descriptorBindingPartiallyBound ||
+            !supported12.descriptorBindingSampledImageUpdateAfterBind || !supported12.descriptorBindingUpdateUnusedWhilePending ||
+            !supported12.shaderSampledImageArrayNonUniformIndexing)
+        {
+            SDL_Log("Error: device does not support the descriptor indexing features the bindless texture table needs");
+            panic();
+        }
+        // frames render with vkCmdBeginRenderingKHR and every barrier is a vkCmdPipelineBarrier2KHR
+        VkPhysicalDeviceSynchronization2FeaturesKHR features_sync2 = {};
+        features_sync2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        features_sync2.synchronization2 = VK_TRUE;
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR features_dynamic_rendering = {};
+        features_dynamic_rendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        features_dynamic_rendering.pNext = &features_sync2;
+        features_dynamic_rendering.dynamicRendering = VK_TRUE;
+        VkPhysicalDeviceVulkan12Features features12 = {};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.pNext = &features_dynamic_rendering;
+        features12.timelineSemaphore = VK_TRUE;
+        features12.bufferDeviceAddress = VK_TRUE;
+        // bindless::set(), a partially bound texture array written while frames using it are in flight
+        features12.descriptorIndexing = VK_TRUE;
+        features12.runtimeDescriptorArray = VK_TRUE;
+        features12.descriptorBindingPartiallyBound = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        // optional, streamed textures stay RGBA8 without it
+        VkPhysicalDeviceFeatures features = {};
+        features.textureCompressionBC = supported.features.textureCompressionBC;
+        g_TextureCompressionBC = features.textureCompressionBC;
+
+        const float queue_priority[] = { 1.0f, 1.0f };
+        VkDeviceQueueCreateInfo queue_info[3] = {};
+        uint32_t queue_info_count = 0;
+        const uint32_t families[] = { g_QueueFamily, g_TransferQueueFamily, g_ComputeQueueFamily };
+        for (uint32_t family : families)
+        {
+            bool created = false;
+            for (uint32_t i = 0; i < queue_info_count; i++)
+                created |= queue_info[i].queueFamilyIndex == family;
+            if (created)
+                continue;
+            VkDeviceQueueCreateInfo& info = queue_info[queue_info_count++];
+            info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            info.queueFamilyIndex = family;
+            info.queueCount = family == g_ComputeQueueFamily ? compute_queue_index + 1 : 1;
+            info.pQueuePriorities = queue_priority;
+        }
         VkDeviceCreateInfo create_info = {};
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        create_info.queueCreateInfoCount = sizeof(queue_info) / sizeof(queue_info[0]);
+        create_info.pNext = &features12;
+        create_info.pEnabledFeatures = &features;
+        create_info.queueCreateInfoCount = queue_info_count;
         create_info.pQueueCreateInfos = queue_info;
         create_info.enabledExtensionCount = (uint32_t)device_extensions.Size;
         create_info.ppEnabledExtensionNames = device_extensions.Data;
         err = vkCreateDevice(g_PhysicalDevice, &create_info, g_vk_Allocator, &device);
         check_vk_result(err);
         vkGetDeviceQueue(device, g_QueueFamily, 0, &g_Queue);
+        vkGetDeviceQueue(device, g_TransferQueueFamily, 0, &g_TransferQueue);
+        vkGetDeviceQueue(device, g_ComputeQueueFamily, compute_queue_index, &g_ComputeQueue);
     }
 
     // Create Descriptor Pool
-    // The example only requires a single combined image sampler descriptor for the font image and only uses one descriptor set (for that)
-    // If you wish to load e.g. additional textures you may need to alter pools sizes.
+    // One combined image sampler set per ImGui texture: the font, the streaming placeholder and every editor thumbnail
     {
         VkDescriptorPoolSize pool_sizes[] =
                 {
-            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, IMGUI_TEXTURE_POOL_SIZE },
     };
         VkDescriptorPoolCreateInfo pool_info = {};
         pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         pool_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-        pool_info.maxSets = 1;
+        pool_info.maxSets = IMGUI_TEXTURE_POOL_SIZE;
         pool_info.poolSizeCount = (uint32_t)IM_ARRAYSIZE(pool_sizes);
         pool_info.pPoolSizes = pool_sizes;
         check_vk_result(vkCreateDescriptorPool(device, &pool_info, g_vk_Allocator, &imgui_DescriptorPool));
     }
         renderer::vma_init();
-}
-
-// All the ImGui_ImplVulkanH_XXX structures/functions are optional helpers used by the demo.
-// Your real engine/app may not use them.
-static void SetupVulkanWindow(ImGui_ImplVulkanH_Window* wd, VkSurfaceKHR surface, int width, int height)
-{
-    wd->Surface = surface;
-
-    // Check for WSI support
-    VkBool32 res;
-    vkGetPhysicalDeviceSurfaceSupportKHR(g_PhysicalDevice, g_QueueFamily, wd->Surface, &res);
-    if (res != VK_TRUE)
-    {
-        SDL_Log("Error no WSI support on physical device 0");
-        panic();
-    }
-
-    // Select Surface Format
-    const VkFormat requestSurfaceImageFormat[] = { VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8_UNORM, VK_FORMAT_R8G8B8_UNORM };
-    const VkColorSpaceKHR requestSurfaceColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR;
-    wd->SurfaceFormat = ImGui_ImplVulkanH_SelectSurfaceFormat(g_PhysicalDevice, wd->Surface, requestSurfaceImageFormat, (size_t)IM_ARRAYSIZE(requestSurfaceImageFormat), requestSurfaceColorSpace);
-
-    // Select Present Mode
-#ifdef APP_UNLIMITED_FRAME_RATE
-    VkPresentModeKHR present_modes[] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR };
-#else
-    VkPresentModeKHR present_modes[] = { VK_PRESENT_MODE_FIFO_KHR };
-#endif
-    wd->PresentMode = ImGui_ImplVulkanH_SelectPresentMode(g_PhysicalDevice, wd->Surface, &present_modes[0], IM_ARRAYSIZE(present_modes));
-    //SDL_Log("[vulkan] Selected PresentMode = %d\n", wd->PresentMode);
-
-    // Create SwapChain, RenderPass, Framebuffer, etc.
-    IM_ASSERT(g_MinImageCount >= 2);
-    ImGui_ImplVulkanH_CreateOrResizeWindow(vk_Instance, g_PhysicalDevice, device, wd, g_QueueFamily, g_vk_Allocator, width, height, g_MinImageCount);
+        timeline::init();
+        pipeline_cache::init();
+        bindless::init();
 }
 
 void CleanupVulkan()
 {
     vkDestroyDescriptorPool(device, imgui_DescriptorPool, g_vk_Allocator);
+    bindless::shutdown();
+    pipeline_cache::shutdown();
+    timeline::shutdown();
 
 #ifdef APP_USE_VULKAN_DEBUG_REPORT
     // Remove the debug report callback
@@ -316,7 +387,9 @@ void CleanupVulkan()
 
 void CleanupVulkanWindow()
 {
-    ImGui_ImplVulkanH_DestroyWindow(vk_Instance, device, &imgui::imgui_MainWindowData, g_vk_Allocator);
+    if (g_Headless)
+        return;
+    swapchain::shutdown();
 }
 
 static void vma_init() {
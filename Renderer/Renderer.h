@@ -18,12 +18,21 @@ namespace renderer {
     inline VkDevice                 device = VK_NULL_HANDLE;
     inline uint32_t                 g_QueueFamily = (uint32_t)-1;
     inline VkQueue                  g_Queue = VK_NULL_HANDLE;
+    // dedicated queues when the device has them, otherwise the same family and queue as g_Queue
+    inline uint32_t                 g_TransferQueueFamily = (uint32_t)-1;
+    inline VkQueue                  g_TransferQueue = VK_NULL_HANDLE;
+    inline uint32_t                 g_ComputeQueueFamily = (uint32_t)-1;
+    inline VkQueue                  g_ComputeQueue = VK_NULL_HANDLE;
     inline VkDebugReportCallbackEXT g_DebugReport = VK_NULL_HANDLE;
     inline VkPipelineCache          g_PipelineCache = VK_NULL_HANDLE;
     inline VkDescriptorPool         imgui_DescriptorPool = VK_NULL_HANDLE;
 
     inline uint32_t                 g_MinImageCount = 2;
     inline bool                     g_SwapChainRebuild = false;
+    // no window or swapchain, set before init()
+    inline bool                     g_Headless = false;
+    // BC1-7 sampling, streamed textures are cooked to BCn when set
+    inline bool                     g_TextureCompressionBC = false;
 
     inline SDL_Window*              window = nullptr;
 
@@ -31,10 +40,4 @@ namespace renderer {
     void CleanupVulkan();
     void CleanupVulkanWindow();
 }
-
-namespace renderer::imgui {
-    inline ImGui_ImplVulkanH_Window imgui_MainWindowData;
-    inline ImGui_ImplVulkanH_Window* wd;
-
-}
 #endif //RENDERER_H
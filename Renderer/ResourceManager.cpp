@@ -1,34 +1,237 @@
 #include "ResourceManager.h"
+#include <algorithm>
+#include <vector>
 
-void default_cleanup(){}
-void deferffl(std::function<void()> &&fn) {
-    cleanups[currentFrame%MAX_INFLIGHT_FRAMES].push_back(std::move(fn));
+#include "GpuTimeline.h"
+#include "FrameAllocator.h"
+#include "StagingRing.h"
+
+namespace {
+    struct RetireBatch {
+        uint64_t value = 0; // timeline value the GPU has to reach before the batch may be destroyed
+        std::vector<DeferredDeletion> deletions;
+        std::vector<DeferredCallback> callbacks;
+    };
+    // ring of batches ordered by value, slots keep their vector capacity after retiring
+    std::vector<RetireBatch> batches;
+    size_t batchHead = 0;
+    size_t batchCount = 0;
+    // retired batches are swapped in here first so cleanups may safely defer more work
+    RetireBatch retiring;
+    struct FrameCommandPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers; // everything ever allocated from pool, recycled after each reset
+        uint32_t used = 0;
+        uint64_t retireValue = 0; // last timeline value submitted while this slot was current
+    };
+    FrameCommandPool commandPools[MAX_INFLIGHT_FRAMES];
+    // only created when uploads run on a dedicated transfer queue family
+    FrameCommandPool transferPools[MAX_INFLIGHT_FRAMES];
+    // secondary buffers for parallel recording, one pool per recording thread and frame slot
+    struct ThreadCommandPools {
+        FrameCommandPool frames[MAX_INFLIGHT_FRAMES];
+    };
+    std::vector<ThreadCommandPools> threadPools;
+    int currentFrame = 0;
+    uint32_t lastFrameCommandBuffers = 0;
+    uint32_t peakFrameCommandBuffers = 0;
+
+    void grow_batches() {
+        std::vector<RetireBatch> grown(batches.empty() ? 4 * MAX_INFLIGHT_FRAMES : batches.size() * 2);
+        for (size_t i = 0; i < batchCount; i++)
+            grown[i] = std::move(batches[(batchHead + i) % batches.size()]);
+        batches.swap(grown);
+        batchHead = 0;
+    }
+    RetireBatch& open_batch() {
+        const uint64_t value = renderer::timeline::pending_value();
+        if (batchCount > 0) {
+            RetireBatch& back = batches[(batchHead + batchCount - 1) % batches.size()];
+            if (back.value == value) return back;
+        }
+        if (batchCount == batches.size()) grow_batches();
+        RetireBatch& batch = batches[(batchHead + batchCount) % batches.size()];
+        batch.value = value;
+        batchCount++;
+        return batch;
+    }
+    VkCommandBuffer acquire_cb(FrameCommandPool& frame, VkCommandBufferLevel level) {
+        if (frame.used < frame.buffers.size())
+            return frame.buffers[frame.used++];
+
+        VkCommandBuffer cb;
+        VkCommandBufferAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = frame.pool,
+            .level = level,
+            .commandBufferCount = 1
+        };
+        vkAllocateCommandBuffers(renderer::device,&allocInfo,&cb);
+        frame.buffers.push_back(cb);
+        frame.used++;
+        return cb;
+    }
+    void reset_pool(FrameCommandPool& frame) {
+        if (frame.used > 0) {
+            vkResetCommandPool(renderer::device, frame.pool, 0);
+            frame.used = 0;
+        }
+    }
+    void create_pool(FrameCommandPool& frame, uint32_t family = renderer::g_QueueFamily) {
+        VkCommandPoolCreateInfo pool_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = family,
+        };
+        vkCreateCommandPool(renderer::device, &pool_info, renderer::g_vk_Allocator, &frame.pool);
+    }
+    void destroy_pool(FrameCommandPool& frame) {
+        if (frame.pool == VK_NULL_HANDLE) return;
+        vkDestroyCommandPool(renderer::device, frame.pool, renderer::g_vk_Allocator);
+        frame.pool = VK_NULL_HANDLE;
+        frame.buffers.clear();
+        frame.used = 0;
+    }
+    void push_deletion(DeferredKind kind, uint64_t handle, VmaAllocation allocation) {
+        open_batch().deletions.push_back({kind, handle, allocation});
+    }
+    void retire_front() {
+        RetireBatch& front = batches[batchHead];
+        RetireBatch& list = retiring;
+        list.deletions.swap(front.deletions);
+        list.callbacks.swap(front.callbacks);
+        batchHead = (batchHead + 1) % batches.size();
+        batchCount--;
+        for (const DeferredDeletion& d : list.deletions) {
+            switch (d.kind) {
+                case DeferredKind::Buffer:
+                    vmaDestroyBuffer(renderer::vma_allocator, (VkBuffer)d.handle, d.allocation);
+                    break;
+                case DeferredKind::Image:
+                    vmaDestroyImage(renderer::vma_allocator, (VkImage)d.handle, d.allocation);
+                    break;
+                case DeferredKind::ImageView:
+                    vkDestroyImageView(renderer::device, (VkImageView)d.handle, renderer::g_vk_Allocator);
+                    break;
+                case DeferredKind::Sampler:
+                    vkDestroySampler(renderer::device, (VkSampler)d.handle, renderer::g_vk_Allocator);
+                    break;
+                case DeferredKind::Allocation:
+                    vmaFreeMemory(renderer::vma_allocator, d.allocation);
+                    break;
+            }
+        }
+        list.deletions.clear();
+        for (auto& f : list.callbacks) {
+            f();
+        }
+        list.callbacks.clear();
+    }
+}
+
+void deferffl(DeferredCallback &&fn) {
+    open_batch().callbacks.push_back(std::move(fn));
+}
+void defer_destroy_buffer(VkBuffer buffer, VmaAllocation allocation) {
+    push_deletion(DeferredKind::Buffer, (uint64_t)buffer, allocation);
+}
+void defer_destroy_image(VkImage image, VmaAllocation allocation) {
+    push_deletion(DeferredKind::Image, (uint64_t)image, allocation);
+}
+void defer_destroy_image_view(VkImageView view) {
+    push_deletion(DeferredKind::ImageView, (uint64_t)view, VK_NULL_HANDLE);
+}
+void defer_destroy_sampler(VkSampler sampler) {
+    push_deletion(DeferredKind::Sampler, (uint64_t)sampler, VK_NULL_HANDLE);
+}
+void defer_free_allocation(VmaAllocation allocation) {
+    push_deletion(DeferredKind::Allocation, 0, allocation);
 }
 void advance_frame_and_execute_cleanups() {
+    // uploads recorded in a frame that never got rendered still have to go out before the slot is reused
+    renderer::staging::submit_frame_uploads();
+    FrameCommandPool& outgoing = commandPools[currentFrame%MAX_INFLIGHT_FRAMES];
+    outgoing.retireValue = renderer::timeline::last_submitted();
+    lastFrameCommandBuffers = outgoing.used;
+    peakFrameCommandBuffers = std::max(peakFrameCommandBuffers, outgoing.used);
+
     currentFrame++;
-    for (const auto& f : cleanups[currentFrame%MAX_INFLIGHT_FRAMES]) {
-        f();
-    }
-    cleanups[currentFrame%MAX_INFLIGHT_FRAMES].clear();
-    deferffl(default_cleanup);
+    FrameCommandPool& incoming = commandPools[currentFrame%MAX_INFLIGHT_FRAMES];
+    // frame fences normally guarantee this already, the wait only matters if something submitted out of band
+    renderer::timeline::wait(incoming.retireValue);
+    reset_pool(incoming);
+    reset_pool(transferPools[currentFrame%MAX_INFLIGHT_FRAMES]);
+    for (auto & thread : threadPools)
+        reset_pool(thread.frames[currentFrame%MAX_INFLIGHT_FRAMES]);
+    renderer::staging::begin_frame(currentFrame%MAX_INFLIGHT_FRAMES);
+    renderer::linear::begin_frame(currentFrame%MAX_INFLIGHT_FRAMES);
+    collect_retired_resources();
+}
+void collect_retired_resources() {
+    const uint64_t completed = renderer::timeline::completed_value();
+    while (batchCount > 0 && batches[batchHead].value <= completed)
+        retire_front();
 }
 VkCommandBuffer make_cb_for_frame() {
-    VkCommandBuffer cb;
-    VkCommandBufferAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = commandPools[currentFrame%MAX_INFLIGHT_FRAMES],
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1
-    };
-    vkAllocateCommandBuffers(renderer::device,&allocInfo,&cb);
-    return cb;
-}
-void init_frame_resource_manager() {
-    VkCommandPoolCreateInfo pool_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
-        .queueFamilyIndex = renderer::g_QueueFamily,
+    return acquire_cb(commandPools[currentFrame%MAX_INFLIGHT_FRAMES], VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+VkCommandBuffer make_transfer_cb_for_frame() {
+    FrameCommandPool& frame = transferPools[currentFrame%MAX_INFLIGHT_FRAMES];
+    if (frame.pool == VK_NULL_HANDLE)
+        return make_cb_for_frame();
+    return acquire_cb(frame, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+VkCommandBuffer make_secondary_cb_for_frame(uint32_t thread) {
+    return acquire_cb(threadPools[thread].frames[currentFrame%MAX_INFLIGHT_FRAMES], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+}
+uint32_t recording_thread_count() {
+    return (uint32_t)threadPools.size();
+}
+FrameCommandStats frame_command_stats() {
+    uint32_t allocated = 0;
+    for (const auto & frame : commandPools)
+        allocated += (uint32_t)frame.buffers.size();
+    for (const auto & frame : transferPools)
+        allocated += (uint32_t)frame.buffers.size();
+    for (const auto & thread : threadPools)
+        for (const auto & frame : thread.frames)
+            allocated += (uint32_t)frame.buffers.size();
+    return {
+        .current_frame = commandPools[currentFrame%MAX_INFLIGHT_FRAMES].used,
+        .last_frame = lastFrameCommandBuffers,
+        .peak_frame = peakFrameCommandBuffers,
+        .allocated = allocated,
     };
-    for (auto & commandPool : commandPools)
-        vkCreateCommandPool(renderer::device, &pool_info, renderer::g_vk_Allocator, &commandPool);
+}
+void init_frame_resource_manager(uint32_t recording_threads) {
+    for (auto & frame : commandPools)
+        create_pool(frame);
+    if (renderer::g_TransferQueueFamily != renderer::g_QueueFamily)
+        for (auto & frame : transferPools)
+            create_pool(frame, renderer::g_TransferQueueFamily);
+    threadPools.resize(recording_threads);
+    for (auto & thread : threadPools)
+        for (auto & frame : thread.frames)
+            create_pool(frame);
+    // warm the arenas up front so steady state streaming never reallocates them
+    grow_batches();
+    for (auto & batch : batches) {
+        batch.deletions.reserve(256);
+        batch.callbacks.reserve(32);
+    }
+    retiring.deletions.reserve(256);
+    retiring.callbacks.reserve(32);
+}
+void shutdown_frame_resource_manager() {
+    renderer::timeline::wait_idle();
+    while (batchCount > 0)
+        retire_front();
+    for (auto & frame : commandPools)
+        destroy_pool(frame);
+    for (auto & frame : transferPools)
+        destroy_pool(frame);
+    for (auto & thread : threadPools)
+        for (auto & frame : thread.frames)
+            destroy_pool(frame);
+    threadPools.clear();
 }
@@ -4,24 +4,139 @@
 
 #ifndef RESOURCEMANAGER_H
 #define RESOURCEMANAGER_H
-#include <functional>
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #include "renderer_constants.h"
 #include <volk.h>
 #include <vk_mem_alloc.h>
 
 #include "Renderer.h"
-static std::vector<std::function<void()>> cleanups[MAX_INFLIGHT_FRAMES];
-static VkCommandPool commandPools[MAX_INFLIGHT_FRAMES];
-static int currentFrame = 0;
-static void default_cleanup();
+
+/**
+ * Type erased cleanup callback that keeps small captures inline, only captures bigger than
+ * inline_size (or with throwing moves) go to the heap.
+ */
+class DeferredCallback {
+public:
+    static constexpr size_t inline_size = 48;
+
+    template<class F>
+        requires (!std::is_same_v<std::decay_t<F>, DeferredCallback>)
+    explicit DeferredCallback(F &&fn) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= inline_size && alignof(Fn) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Fn>) {
+            new (storage) Fn(std::forward<F>(fn));
+            ops = &inline_ops<Fn>;
+        } else {
+            *reinterpret_cast<Fn **>(storage) = new Fn(std::forward<F>(fn));
+            ops = &heap_ops<Fn>;
+        }
+    }
+    // moving from an already moved-from callback leaves both empty
+    DeferredCallback(DeferredCallback &&other) noexcept : ops(other.ops) {
+        if (ops)
+            ops->relocate(storage, other.storage);
+        other.ops = nullptr;
+    }
+    DeferredCallback(const DeferredCallback &) = delete;
+    DeferredCallback &operator=(const DeferredCallback &) = delete;
+    DeferredCallback &operator=(DeferredCallback &&) = delete;
+    ~DeferredCallback() { if (ops) ops->destroy(storage); }
+
+    void operator()() { ops->invoke(storage); }
+
+private:
+    struct Ops {
+        void (*invoke)(void *);
+        void (*relocate)(void *dst, void *src);
+        void (*destroy)(void *);
+    };
+    template<class Fn>
+    static constexpr Ops inline_ops = {
+        +[](void *p) { (*static_cast<Fn *>(p))(); },
+        +[](void *dst, void *src) {
+            new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+            static_cast<Fn *>(src)->~Fn();
+        },
+        +[](void *p) { static_cast<Fn *>(p)->~Fn(); },
+    };
+    template<class Fn>
+    static constexpr Ops heap_ops = {
+        +[](void *p) { (**static_cast<Fn **>(p))(); },
+        +[](void *dst, void *src) { *static_cast<Fn **>(dst) = *static_cast<Fn **>(src); },
+        +[](void *p) { delete *static_cast<Fn **>(p); },
+    };
+
+    alignas(std::max_align_t) unsigned char storage[inline_size];
+    const Ops *ops;
+};
+
+enum class DeferredKind : uint8_t {
+    Buffer,
+    Image,
+    ImageView,
+    Sampler,
+    Allocation,
+};
+
+/// plain record retired in bulk, handle is the non-dispatchable vulkan handle as integer
+struct DeferredDeletion {
+    DeferredKind kind;
+    uint64_t handle;
+    VmaAllocation allocation;
+};
+static_assert(std::is_trivially_copyable_v<DeferredDeletion>);
+
 /**
  * defer for frame lifetime
- * @param fn cleanup function to run after all proccessing with current frame finishes
+ * @param fn cleanup function to run once the GPU passes the next timeline submit, i.e. after everything
+ * recorded so far finished executing
  */
-void deferffl(std::function<void()> &&fn);
+void deferffl(DeferredCallback &&fn);
+template<class F>
+    requires (!std::is_same_v<std::decay_t<F>, DeferredCallback>)
+void deferffl(F &&fn) { deferffl(DeferredCallback(std::forward<F>(fn))); }
+
+/// typed variants of deferffl, these never allocate once the frame arenas are warm
+void defer_destroy_buffer(VkBuffer buffer, VmaAllocation allocation = VK_NULL_HANDLE);
+void defer_destroy_image(VkImage image, VmaAllocation allocation = VK_NULL_HANDLE);
+void defer_destroy_image_view(VkImageView view);
+void defer_destroy_sampler(VkSampler sampler);
+void defer_free_allocation(VmaAllocation allocation);
+
+struct FrameCommandStats {
+    uint32_t current_frame; // command buffers handed out so far this frame
+    uint32_t last_frame;
+    uint32_t peak_frame;
+    uint32_t allocated;     // live primary and secondary command buffers across all frame slots
+};
+
 void advance_frame_and_execute_cleanups();
+/// destroys every deferred batch whose timeline value the GPU already reached
+void collect_retired_resources();
+/**
+ * primary command buffer valid until this frame slot comes around again, the slot's pool is reset then
+ * and its buffers are handed out again instead of allocating new ones
+ */
 VkCommandBuffer make_cb_for_frame();
-void init_frame_resource_manager();
+/// same as make_cb_for_frame for submits to g_TransferQueue, which may be a different queue family
+VkCommandBuffer make_transfer_cb_for_frame();
+FrameCommandStats frame_command_stats();
+/**
+ * secondary command buffer from the calling recording thread's own pool for this frame slot
+ * @param thread worker index in [0, recording_thread_count()), only that worker may use it
+ */
+VkCommandBuffer make_secondary_cb_for_frame(uint32_t thread);
+uint32_t recording_thread_count();
+/**
+ * @param recording_threads number of worker threads that get their own command pool per in-flight frame
+ */
+void init_frame_resource_manager(uint32_t recording_threads = 0);
+/// runs every pending cleanup regardless of frame, device must be idle
+void shutdown_frame_resource_manager();
 #endif //RESOURCEMANAGER_H
@@ -0,0 +1,446 @@
+#include "SpriteBatcher.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <SDL3/SDL_log.h>
+
+#include "Bindless.h"
+#include "EngineImage.h"
+#include "FrameAllocator.h"
+#include "ParallelRecorder.h"
+#include "Renderer.h"
+#include "renderer_constants.h"
+#include "../debug_panic.h"
+#include "../love_profiler.h"
+
+namespace renderer::sprites {
+    namespace {
+        const uint32_t sprite_vert_spv[] = {
+#include "sprite.vert.spv.h"
+        };
+        const uint32_t sprite_frag_spv[] = {
+#include "sprite.frag.spv.h"
+        };
+        // one per sprite in the frame allocator, matches the vertex inputs of sprite.vert
+        struct Instance {
+            float basis[4];     // x and y axis scaled by the size
+            float center[2];
+            float uv[4];
+            uint32_t color;
+            uint32_t texture;   // bindless handle
+        };
+        static_assert(sizeof(Instance) == 48);
+        struct Push {
+            float scale[2];
+            float offset[2];
+        };
+
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        // nullptr while the slot is free
+        std::vector<EngineImage *> slots;
+        std::vector<SpriteTexture> freeSlots;
+
+        float cameraX = 0.0f, cameraY = 0.0f, cameraZoom = 1.0f;
+
+        // submitted sprites, the key's low 32 bits index these arrays
+        std::vector<uint64_t> keys;
+        std::vector<uint64_t> sortScratch;
+        std::vector<SpriteTexture> textures;
+        std::vector<std::array<float, 2>> centers;
+        std::vector<std::array<float, 2>> sizes;
+        std::vector<float> rotations;
+        std::vector<std::array<float, 4>> uvs;
+        std::vector<uint32_t> colors;
+
+        // per job results of a parallel record
+        std::vector<uint32_t> jobWritten, jobSkipped;
+
+        SpriteStats lastStats = {};
+        double totalSortMs = 0.0, totalWriteMs = 0.0;
+
+        void check(VkResult err, const char *what) {
+            if (err == VK_SUCCESS)
+                return;
+            SDL_Log("[sprites] Error: %s failed with VkResult %d", what, err);
+            panic();
+        }
+
+        VkShaderModule create_module(const uint32_t *code, size_t size) {
+            VkShaderModuleCreateInfo module_info = {
+                .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                .codeSize = size,
+                .pCode = code,
+            };
+            VkShaderModule module;
+            check(vkCreateShaderModule(device, &module_info, g_vk_Allocator, &module), "vkCreateShaderModule");
+            return module;
+        }
+
+        void create_pipeline(VkFormat color_format) {
+            VkDescriptorSetLayout set_layout = bindless::set_layout();
+            VkPushConstantRange range = {VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push)};
+            VkPipelineLayoutCreateInfo layout_info = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+                .setLayoutCount = 1,
+                .pSetLayouts = &set_layout,
+                .pushConstantRangeCount = 1,
+                .pPushConstantRanges = &range,
+            };
+            check(vkCreatePipelineLayout(device, &layout_info, g_vk_Allocator, &pipelineLayout), "vkCreatePipelineLayout");
+
+            VkShaderModule vert = create_module(sprite_vert_spv, sizeof(sprite_vert_spv));
+            VkShaderModule frag = create_module(sprite_frag_spv, sizeof(sprite_frag_spv));
+            VkPipelineShaderStageCreateInfo stages[] = {
+                {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_VERTEX_BIT, .module = vert, .pName = "main"},
+                {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, .stage = VK_SHADER_STAGE_FRAGMENT_BIT, .module = frag, .pName = "main"},
+            };
+
+            // no per-vertex data, the quad corners come from gl_VertexIndex
+            VkVertexInputBindingDescription instance_binding = {0, sizeof(Instance), VK_VERTEX_INPUT_RATE_INSTANCE};
+            VkVertexInputAttributeDescription attributes[] = {
+                {0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Instance, basis)},
+                {1, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Instance, center)},
+                {2, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Instance, uv)},
+                {3, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(Instance, color)},
+                {4, 0, VK_FORMAT_R32_UINT, offsetof(Instance, texture)},
+            };
+            VkPipelineVertexInputStateCreateInfo vertex_input = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+                .vertexBindingDescriptionCount = 1,
+                .pVertexBindingDescriptions = &instance_binding,
+                .vertexAttributeDescriptionCount = 5,
+                .pVertexAttributeDescriptions = attributes,
+            };
+            VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+                .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+            };
+            VkPipelineViewportStateCreateInfo viewport = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+                .viewportCount = 1,
+                .scissorCount = 1,
+            };
+            // mirrored sprites flip the winding
+            VkPipelineRasterizationStateCreateInfo raster = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+                .polygonMode = VK_POLYGON_MODE_FILL,
+                .cullMode = VK_CULL_MODE_NONE,
+                .lineWidth = 1.0f,
+            };
+            VkPipelineMultisampleStateCreateInfo multisample = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+                .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+            };
+            VkPipelineColorBlendAttachmentState blend_attachment = {
+                .blendEnable = VK_TRUE,
+                .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+                .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+                .colorBlendOp = VK_BLEND_OP_ADD,
+                .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+                .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+                .alphaBlendOp = VK_BLEND_OP_ADD,
+                .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+            };
+            VkPipelineColorBlendStateCreateInfo blend = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+                .attachmentCount = 1,
+                .pAttachments = &blend_attachment,
+            };
+            VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+            VkPipelineDynamicStateCreateInfo dynamic = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+                .dynamicStateCount = 2,
+                .pDynamicStates = dynamic_states,
+            };
+            VkPipelineRenderingCreateInfo rendering = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+                .colorAttachmentCount = 1,
+                .pColorAttachmentFormats = &color_format,
+            };
+            VkGraphicsPipelineCreateInfo pipeline_info = {
+                .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+                .pNext = &rendering,
+                .stageCount = 2,
+                .pStages = stages,
+                .pVertexInputState = &vertex_input,
+                .pInputAssemblyState = &input_assembly,
+                .pViewportState = &viewport,
+                .pRasterizationState = &raster,
+                .pMultisampleState = &multisample,
+                .pColorBlendState = &blend,
+                .pDynamicState = &dynamic,
+                .layout = pipelineLayout,
+            };
+            check(vkCreateGraphicsPipelines(device, g_PipelineCache, 1, &pipeline_info, g_vk_Allocator, &pipeline),
+                  "vkCreateGraphicsPipelines");
+            vkDestroyShaderModule(device, vert, g_vk_Allocator);
+            vkDestroyShaderModule(device, frag, g_vk_Allocator);
+        }
+
+        /**
+         * LSD radix sort on the layer half of the keys. The low half is the submission index, which is already
+         * ascending, so a stable sort of the 16 layer bits orders the whole key. Bytes that are the same in every key
+         * are skipped, a frame on a single layer is not sorted at all.
+         */
+        void sort_keys() {
+            const size_t count = keys.size();
+            sortScratch.resize(count);
+            uint64_t *src = keys.data(), *dst = sortScratch.data();
+            for (uint32_t shift = 32; shift < 48; shift += 8) {
+                size_t histogram[256] = {};
+                for (size_t i = 0; i < count; i++)
+                    histogram[(src[i] >> shift) & 0xFF]++;
+                if (histogram[(src[0] >> shift) & 0xFF] == count)
+                    continue;
+                size_t offset = 0;
+                for (size_t &bucket : histogram) {
+                    const size_t n = bucket;
+                    bucket = offset;
+                    offset += n;
+                }
+                for (size_t i = 0; i < count; i++)
+                    dst[histogram[(src[i] >> shift) & 0xFF]++] = src[i];
+                std::swap(src, dst);
+            }
+            if (src != keys.data())
+                keys.swap(sortScratch);
+        }
+
+        EngineImage *ready_image(SpriteTexture texture) {
+            if (texture >= slots.size() || !slots[texture] || !slots[texture]->uploaded ||
+                slots[texture]->bindless == bindless::INVALID_TEXTURE_HANDLE)
+                return nullptr;
+            return slots[texture];
+        }
+
+        // the state every command buffer the sprites are drawn from needs, instances start at allocation
+        void bind_state(VkCommandBuffer cb, const linear::FrameAllocation &allocation, uint32_t width, uint32_t height) {
+            vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            VkViewport viewport = {0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f};
+            VkRect2D scissor = {{0, 0}, {width, height}};
+            vkCmdSetViewport(cb, 0, 1, &viewport);
+            vkCmdSetScissor(cb, 0, 1, &scissor);
+            Push push;
+            push.scale[0] = 2.0f * cameraZoom / (float)width;
+            push.scale[1] = 2.0f * cameraZoom / (float)height;
+            push.offset[0] = -1.0f - cameraX * push.scale[0];
+            push.offset[1] = -1.0f - cameraY * push.scale[1];
+            vkCmdPushConstants(cb, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Push), &push);
+            vkCmdBindVertexBuffers(cb, 0, 1, &allocation.buffer, &allocation.offset);
+            VkDescriptorSet set = bindless::set();
+            vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &set, 0, nullptr);
+        }
+
+        void write_instance(Instance *out, uint32_t sprite, uint32_t texture) {
+            const float width = sizes[sprite][0], height = sizes[sprite][1];
+            float c = 1.0f, s = 0.0f;
+            if (rotations[sprite] != 0.0f) {
+                c = cosf(rotations[sprite]);
+                s = sinf(rotations[sprite]);
+            }
+            // built on the stack and stored whole, the destination is write combined mapped memory
+            const Instance instance = {
+                {c * width, s * width, -s * height, c * height},
+                {centers[sprite][0], centers[sprite][1]},
+                {uvs[sprite][0], uvs[sprite][1], uvs[sprite][2], uvs[sprite][3]},
+                colors[sprite],
+                texture,
+            };
+            *out = instance;
+        }
+
+        /**
+         * writes the sorted sprites [begin, end) packed from instances on, runs whose texture is not ready are left out
+         * @return instances written
+         */
+        uint32_t write_range(Instance *instances, size_t begin, size_t end, uint32_t &skipped) {
+            uint32_t written = 0;
+            while (begin < end) {
+                // a run is consecutive sprites sharing a texture, which is looked up once
+                const SpriteTexture texture = textures[(uint32_t)keys[begin]];
+                size_t run_end = begin + 1;
+                while (run_end < end && textures[(uint32_t)keys[run_end]] == texture)
+                    run_end++;
+                EngineImage *image = ready_image(texture);
+                if (!image) {
+                    skipped += (uint32_t)(run_end - begin);
+                    begin = run_end;
+                    continue;
+                }
+                for (size_t i = begin; i < run_end; i++)
+                    write_instance(instances + written++, (uint32_t)keys[i], image->bindless);
+                begin = run_end;
+            }
+            return written;
+        }
+
+        void finish_stats(SpriteStats &frame, std::chrono::steady_clock::time_point sort_start,
+                          std::chrono::steady_clock::time_point write_start) {
+            const auto write_end = std::chrono::steady_clock::now();
+            frame.sort_ms = std::chrono::duration<float, std::milli>(write_start - sort_start).count();
+            frame.write_ms = std::chrono::duration<float, std::milli>(write_end - write_start).count();
+            totalSortMs += frame.sort_ms;
+            totalWriteMs += frame.write_ms;
+            frame.frames = lastStats.frames + 1;
+            frame.avg_sort_ms = (float)(totalSortMs / frame.frames);
+            frame.avg_write_ms = (float)(totalWriteMs / frame.frames);
+            lastStats = frame;
+        }
+    }
+
+    void init(VkFormat color_format) {
+        create_pipeline(color_format);
+    }
+
+    void shutdown() {
+        vkDestroyPipeline(device, pipeline, g_vk_Allocator);
+        vkDestroyPipelineLayout(device, pipelineLayout, g_vk_Allocator);
+        pipeline = VK_NULL_HANDLE;
+        pipelineLayout = VK_NULL_HANDLE;
+        slots.clear();
+        freeSlots.clear();
+    }
+
+    SpriteTexture add_texture(EngineImage &image) {
+        SpriteTexture texture;
+        if (!freeSlots.empty()) {
+            texture = freeSlots.back();
+            freeSlots.pop_back();
+        } else if (slots.size() < MAX_SPRITE_TEXTURES) {
+            texture = (SpriteTexture)slots.size();
+            slots.push_back(nullptr);
+        } else {
+            SDL_Log("[sprites] Warning: all %d texture slots are taken", MAX_SPRITE_TEXTURES);
+            return INVALID_SPRITE_TEXTURE;
+        }
+        slots[texture] = &image;
+        return texture;
+    }
+
+    void remove_texture(SpriteTexture texture) {
+        if (texture >= slots.size() || !slots[texture])
+            return;
+        // the descriptor belongs to the image, nothing here outlives the frame
+        slots[texture] = nullptr;
+        freeSlots.push_back(texture);
+    }
+
+    void set_camera(float x, float y, float zoom) {
+        cameraX = x;
+        cameraY = y;
+        cameraZoom = zoom;
+    }
+
+    void begin_frame() {
+        keys.clear();
+        textures.clear();
+        centers.clear();
+        sizes.clear();
+        rotations.clear();
+        uvs.clear();
+        colors.clear();
+    }
+
+    void submit(const Sprite &sprite) {
+        const uint32_t index = (uint32_t)keys.size();
+        // layer then submission order, sorting by texture would reorder overlapping blended sprites for nothing
+        keys.push_back((uint64_t)sprite.layer << 32 | index);
+        textures.push_back(sprite.texture);
+        centers.push_back({sprite.x, sprite.y});
+        sizes.push_back({sprite.width, sprite.height});
+        rotations.push_back(sprite.rotation);
+        uvs.push_back({sprite.u0, sprite.v0, sprite.u1, sprite.v1});
+        colors.push_back(sprite.color);
+    }
+
+    uint32_t submitted() {
+        return (uint32_t)keys.size();
+    }
+
+    void record(VkCommandBuffer cb, uint32_t width, uint32_t height) {
+        LOVE_ZONE("Sprites");
+        if (keys.empty()) {
+            lastStats.sprites = lastStats.skipped = lastStats.draws = lastStats.jobs = 0;
+            lastStats.sort_ms = lastStats.write_ms = 0.0f;
+            return;
+        }
+        SpriteStats frame = {};
+
+        const auto sort_start = std::chrono::steady_clock::now();
+        sort_keys();
+        const auto write_start = std::chrono::steady_clock::now();
+
+        // sized for every sprite, runs whose texture is not ready leave their part unused
+        const linear::FrameAllocation allocation = linear::allocate_array<Instance>((uint32_t)keys.size());
+        Instance *instances = static_cast<Instance *>(allocation.ptr);
+        if (!instances) {
+            SDL_Log("[sprites] Warning: %zu sprites do not fit the frame allocator", keys.size());
+            frame.skipped = (uint32_t)keys.size();
+        } else {
+            bind_state(cb, allocation, width, height);
+            const uint32_t written = write_range(instances, 0, keys.size(), frame.skipped);
+            // textures are indexed per instance, skipped runs leave no gap so everything is one draw
+            if (written > 0) {
+                vkCmdDraw(cb, 4, written, 0, 0);
+                frame.draws = 1;
+            }
+            frame.sprites = written;
+        }
+        finish_stats(frame, sort_start, write_start);
+    }
+
+    void record(VkCommandBuffer cb, const VkCommandBufferInheritanceRenderingInfo &rendering, uint32_t width,
+                uint32_t height) {
+        LOVE_ZONE("Sprites");
+        if (keys.empty()) {
+            lastStats.sprites = lastStats.skipped = lastStats.draws = lastStats.jobs = 0;
+            lastStats.sort_ms = lastStats.write_ms = 0.0f;
+            return;
+        }
+        SpriteStats frame = {};
+
+        const auto sort_start = std::chrono::steady_clock::now();
+        sort_keys();
+        const auto write_start = std::chrono::steady_clock::now();
+
+        const linear::FrameAllocation allocation = linear::allocate_array<Instance>((uint32_t)keys.size());
+        Instance *instances = static_cast<Instance *>(allocation.ptr);
+        if (!instances) {
+            SDL_Log("[sprites] Warning: %zu sprites do not fit the frame allocator", keys.size());
+            frame.skipped = (uint32_t)keys.size();
+            finish_stats(frame, sort_start, write_start);
+            return;
+        }
+        // each job writes and draws one contiguous slice of the sorted sprites, executing the jobs in order keeps
+        // the draw order of a single job
+        const uint32_t count = (uint32_t)keys.size();
+        const uint32_t jobs = std::clamp<uint32_t>((count + SPRITES_PER_RECORD_JOB - 1) / SPRITES_PER_RECORD_JOB, 1,
+                                                   std::max(parallel::thread_count(), 1u));
+        jobWritten.assign(jobs, 0);
+        jobSkipped.assign(jobs, 0);
+        parallel::record(cb, rendering, jobs, [&](VkCommandBuffer job_cb, uint32_t job) {
+            const size_t begin = (size_t)count * job / jobs, end = (size_t)count * (job + 1) / jobs;
+            jobWritten[job] = write_range(instances + begin, begin, end, jobSkipped[job]);
+            if (jobWritten[job] == 0)
+                return;
+            bind_state(job_cb, allocation, width, height);
+            vkCmdDraw(job_cb, 4, jobWritten[job], 0, (uint32_t)begin);
+        });
+        for (uint32_t job = 0; job < jobs; job++) {
+            frame.sprites += jobWritten[job];
+            frame.skipped += jobSkipped[job];
+            frame.draws += jobWritten[job] > 0;
+        }
+        frame.jobs = jobs;
+        finish_stats(frame, sort_start, write_start);
+    }
+
+    SpriteStats stats() {
+        return lastStats;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef SPRITEBATCHER_H
+#define SPRITEBATCHER_H
+#include <cstdint>
+#include <volk.h>
+
+class EngineImage;
+
+/**
+ * Instanced 2D sprite renderer. Sprites submitted during a frame are kept in structure of arrays form, sorted
+ * by a 64 bit key (layer, submission order) and written as 48 byte instances into the frame's linear allocator.
+ * Instances carry the texture's bindless handle, so a frame is a single vkCmdDraw of a 4 vertex strip no matter
+ * how many textures it uses, and sprites on a layer are drawn in the order they were submitted. Recorded in
+ * parallel, each job draws its own slice of the sorted instances.
+ */
+namespace renderer::sprites {
+    /// slot of a texture registered with add_texture
+    using SpriteTexture = uint16_t;
+    constexpr SpriteTexture INVALID_SPRITE_TEXTURE = UINT16_MAX;
+
+    struct Sprite {
+        SpriteTexture texture;
+        float x, y;                 // center in world units, pixels at zoom 1 with y pointing down
+        float width, height;
+        float rotation = 0.0f;      // radians, clockwise on screen
+        float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+        uint32_t color = 0xFFFFFFFF; // RGBA8 with R in the lowest byte, multiplies the texel
+        uint16_t layer = 0;         // lower layers are drawn first, submission order is kept within a layer
+    };
+
+    /// @param color_format format of the dynamic rendering color attachment sprites are drawn into
+    void init(VkFormat color_format);
+    /// device must be idle
+    void shutdown();
+
+    /**
+     * @param image sampled through its bindless handle, must outlive the slot, sprites using it are skipped until
+     * it is uploaded
+     * @return INVALID_SPRITE_TEXTURE once all MAX_SPRITE_TEXTURES slots are taken
+     */
+    SpriteTexture add_texture(EngineImage &image);
+    /// the slot is handed out again right away, sprites already submitted with it this frame draw whatever takes it
+    void remove_texture(SpriteTexture texture);
+
+    /// top left corner of the view in world units
+    void set_camera(float x, float y, float zoom);
+    /// drops sprites that were submitted but never recorded, call once at the start of every frame
+    void begin_frame();
+    void submit(const Sprite &sprite);
+    /// sprites submitted since begin_frame
+    uint32_t submitted();
+    /**
+     * sorts and records this frame's sprites, cb must be inside a dynamic rendering pass on a color_format target
+     * @param width,height render area in pixels
+     */
+    void record(VkCommandBuffer cb, uint32_t width, uint32_t height);
+    /**
+     * same, with instance writing and recording split over parallel::record jobs of up to SPRITES_PER_RECORD_JOB
+     * sprites, one draw each
+     * @param cb primary inside a rendering scope begun with VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT, e.g.
+     * a graph pass marked with graph::secondaries()
+     * @param rendering what the scope's secondaries inherit, e.g. graph::rendering_inheritance()
+     */
+    void record(VkCommandBuffer cb, const VkCommandBufferInheritanceRenderingInfo &rendering, uint32_t width,
+                uint32_t height);
+
+    struct SpriteStats {
+        uint32_t sprites;       // drawn in the last recorded frame
+        uint32_t skipped;       // sprites whose texture was not uploaded or did not fit the frame allocator
+        uint32_t draws;
+        uint32_t jobs;          // secondaries recorded in parallel, 0 when recorded inline
+        float sort_ms;
+        float write_ms;         // instance generation into mapped memory, and command recording when parallel
+        float avg_sort_ms;      // over every recorded frame
+        float avg_write_ms;
+        uint32_t frames;
+    };
+    SpriteStats stats();
+}
+#endif //SPRITEBATCHER_H
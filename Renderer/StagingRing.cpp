@@ -0,0 +1,497 @@
+#include "StagingRing.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <vector>
+#include <SDL3/SDL_log.h>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define STAGING_X86 1
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "GpuTimeline.h"
+#include "Renderer.h"
+#include "renderer_constants.h"
+#include "../debug_panic.h"
+
+namespace renderer::staging {
+    namespace {
+        struct Segment {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            uint8_t *mapped = nullptr;
+            VkDeviceSize head = 0;
+        };
+        struct PendingUpload {
+            bool is_image;
+            ImageUpload image;
+            VkBuffer dst;
+            VkDeviceSize dst_offset;
+            const uint8_t *data;
+            VkDeviceSize size;
+            VkDeviceSize done;     // rows for images, bytes for buffers
+            void (*release)(void *);
+            std::optional<DeferredCallback> on_uploaded;
+        };
+
+        Segment segments[MAX_INFLIGHT_FRAMES];
+        uint32_t slot = 0;
+        VkCommandBuffer cb = VK_NULL_HANDLE;
+        VkCommandBuffer acquireCb = VK_NULL_HANDLE;
+        std::deque<PendingUpload> queue;
+        std::vector<PendingUpload> finished;
+        // copies into the same image recorded back to back, flushed as one vkCmdCopyBufferToImage
+        std::vector<VkBufferImageCopy> imageCopies;
+        VkImage imageCopyTarget = VK_NULL_HANDLE;
+        barriers::BarrierBatch uploadBarriers;
+        barriers::BarrierBatch releaseBarriers;
+        barriers::BarrierBatch acquireBarriers;
+        // signaled by the transfer queue submits, only exists with a dedicated transfer family
+        VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+        uint64_t transferSubmitted = 0;
+
+        bool dedicated_transfer() {
+            return g_TransferQueueFamily != g_QueueFamily;
+        }
+        void begin(VkCommandBuffer buffer) {
+            VkCommandBufferBeginInfo begin_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+                .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+            };
+            vkBeginCommandBuffer(buffer, &begin_info);
+        }
+
+        VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+        VkDeviceSize space_left(VkDeviceSize alignment) {
+            const VkDeviceSize offset = align_up(segments[slot].head, alignment);
+            return offset < STAGING_RING_SIZE ? STAGING_RING_SIZE - offset : 0;
+        }
+
+#if defined(STAGING_X86)
+        bool cpu_has_ssse3() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return info[2] >> 9 & 1;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3");
+#endif
+        }
+
+        // built for SSSE3 whatever the build targets, only called once the CPU is known to have it
+#if defined(__GNUC__) || defined(__clang__)
+        __attribute__((target("ssse3")))
+#endif
+        uint32_t expand_to_rgba8_ssse3(uint8_t *dst, const uint8_t *src, uint32_t count, uint32_t channels) {
+            uint32_t i = 0;
+            const __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+            if (channels == 3) {
+                const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+                // a 16 byte load covers 5 1/3 texels, the last ones of a row go through the scalar loop
+                for (; i + 6 <= count; i += 4) {
+                    const __m128i rgb = _mm_loadu_si128((const __m128i *)(src + i * 3));
+                    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, spread), opaque));
+                }
+            } else if (channels == 2) {
+                const __m128i low = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+                const __m128i high = _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15);
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i ga = _mm_loadu_si128((const __m128i *)(src + i * 2));
+                    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(ga, low));
+                    _mm_storeu_si128((__m128i *)(dst + i * 4 + 16), _mm_shuffle_epi8(ga, high));
+                }
+            } else if (channels == 1) {
+                // each quarter of the load takes the next 4 gray bytes, the alpha lanes stay -1 and read as zero
+                const __m128i first = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+                const __m128i step = _mm_set1_epi32(0x00040404);
+                for (; i + 16 <= count; i += 16) {
+                    const __m128i gray = _mm_loadu_si128((const __m128i *)(src + i));
+                    __m128i spread = first;
+                    for (uint32_t quarter = 0; quarter < 4; quarter++) {
+                        _mm_storeu_si128((__m128i *)(dst + i * 4 + quarter * 16),
+                                         _mm_or_si128(_mm_shuffle_epi8(gray, spread), opaque));
+                        spread = _mm_add_epi8(spread, step);
+                    }
+                }
+            }
+            return i;
+        }
+#endif
+
+        /**
+         * widens count texels of gray, gray alpha or RGB bytes to RGBA8 as they are written to staging memory, gray
+         * goes to all three colour channels. SSSE3 shuffles on x86 CPUs that have them, NEON on ARM
+         */
+        void expand_to_rgba8(uint8_t *dst, const uint8_t *src, uint32_t count, uint32_t channels) {
+            uint32_t i = 0;
+#if defined(STAGING_X86)
+            static const bool ssse3 = cpu_has_ssse3();
+            if (ssse3)
+                i = expand_to_rgba8_ssse3(dst, src, count, channels);
+#elif defined(__ARM_NEON)
+            const uint8x16_t opaque = vdupq_n_u8(255);
+            if (channels == 3) {
+                for (; i + 16 <= count; i += 16) {
+                    const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+                    vst4q_u8(dst + i * 4, (uint8x16x4_t){{rgb.val[0], rgb.val[1], rgb.val[2], opaque}});
+                }
+            } else if (channels == 2) {
+                for (; i + 16 <= count; i += 16) {
+                    const uint8x16x2_t ga = vld2q_u8(src + i * 2);
+                    vst4q_u8(dst + i * 4, (uint8x16x4_t){{ga.val[0], ga.val[0], ga.val[0], ga.val[1]}});
+                }
+            } else if (channels == 1) {
+                for (; i + 16 <= count; i += 16) {
+                    const uint8x16_t gray = vld1q_u8(src + i);
+                    vst4q_u8(dst + i * 4, (uint8x16x4_t){{gray, gray, gray, opaque}});
+                }
+            }
+#endif
+            for (; i < count; i++) {
+                const uint8_t *in = src + i * channels;
+                uint8_t *out = dst + i * 4;
+                if (channels == 3) {
+                    out[0] = in[0];
+                    out[1] = in[1];
+                    out[2] = in[2];
+                } else {
+                    out[0] = out[1] = out[2] = in[0];
+                }
+                out[3] = channels == 2 ? in[1] : 255;
+            }
+        }
+
+        void release(const PendingUpload &up) {
+            if (!up.release)
+                return;
+            if (up.is_image)
+                up.release(up.image.owner ? up.image.owner : (void *)up.image.pixels);
+            else
+                up.release((void *)up.data);
+        }
+
+        void flush_image_copies() {
+            if (imageCopies.empty())
+                return;
+            vkCmdCopyBufferToImage(upload_cb(), segments[slot].buffer, imageCopyTarget, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   (uint32_t)imageCopies.size(), imageCopies.data());
+            imageCopies.clear();
+        }
+
+        // records as much of upload as fits, true once all of it is recorded
+        bool advance(PendingUpload &up) {
+            StagingRegion region;
+            if (up.is_image) {
+                const ImageUpload &img = up.image;
+                // rows are rows of blocks for compressed formats
+                const uint32_t block = img.block_extent;
+                const uint32_t height_rows = (img.height + block - 1) / block;
+                const VkDeviceSize row_bytes = (VkDeviceSize)((img.width + block - 1) / block) * img.texel_size;
+                // copy offsets must be a multiple of both the texel size and 4
+                const VkDeviceSize alignment = img.texel_size % 4 == 0 ? img.texel_size
+                                             : img.texel_size % 2 == 0 ? img.texel_size * 2
+                                             : img.texel_size * 4;
+                if (row_bytes > STAGING_RING_SIZE) {
+                    SDL_Log("[staging] Error: a single %llu byte row exceeds the staging ring", (unsigned long long)row_bytes);
+                    panic();
+                }
+                const VkDeviceSize rows = std::min<VkDeviceSize>(height_rows - up.done, space_left(alignment) / row_bytes);
+                if (rows == 0 || !allocate(rows * row_bytes, alignment, region))
+                    return false;
+                if (img.source_channels) {
+                    const size_t source_row = (size_t)img.width * img.source_channels;
+                    for (VkDeviceSize row = 0; row < rows; row++)
+                        expand_to_rgba8(region.ptr + row * row_bytes, img.pixels + (up.done + row) * source_row,
+                                        img.width, img.source_channels);
+                } else {
+                    memcpy(region.ptr, img.pixels + up.done * row_bytes, rows * row_bytes);
+                }
+                VkBufferImageCopy copy = {
+                    .bufferOffset = region.offset,
+                    .bufferRowLength = 0,
+                    .bufferImageHeight = 0,
+                    .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, img.mip, img.layer, 1},
+                    .imageOffset = {0, (int32_t)(up.done * block), 0},
+                    // a partial block at the bottom edge is only allowed as the subresource's last row
+                    .imageExtent = {img.width, std::min<uint32_t>((uint32_t)rows * block, img.height - (uint32_t)up.done * block), 1},
+                };
+                // every level and layer of an image shares one copy command as long as they fit this frame
+                if (img.image != imageCopyTarget)
+                    flush_image_copies();
+                imageCopyTarget = img.image;
+                imageCopies.push_back(copy);
+                up.done += rows;
+                return up.done == height_rows;
+            }
+            const VkDeviceSize bytes = std::min(up.size - up.done, space_left(16));
+            if (bytes == 0 || !allocate(bytes, 16, region))
+                return false;
+            memcpy(region.ptr, up.data + up.done, bytes);
+            flush_image_copies();
+            VkBufferCopy copy = {
+                .srcOffset = region.offset,
+                .dstOffset = up.dst_offset + up.done,
+                .size = bytes,
+            };
+            vkCmdCopyBuffer(upload_cb(), region.buffer, up.dst, 1, &copy);
+            up.done += bytes;
+            return up.done == up.size;
+        }
+
+        // release on the transfer queue, acquire on the graphics queue, the layout stays TRANSFER_DST_OPTIMAL
+        void transfer_ownership(const PendingUpload &up) {
+            if (!dedicated_transfer())
+                return;
+            // the release's destination and the acquire's source scope are ignored, the semaphore orders the two
+            if (up.is_image) {
+                VkImageMemoryBarrier2 barrier = {
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                    .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                    .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                    .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+                    .dstAccessMask = VK_ACCESS_2_NONE,
+                    .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .srcQueueFamilyIndex = g_TransferQueueFamily,
+                    .dstQueueFamilyIndex = g_QueueFamily,
+                    .image = up.image.image,
+                    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, up.image.mip, 1, up.image.layer, 1},
+                };
+                releaseBarriers.add(barrier);
+                // finish_upload continues with blits, or a compute mip chain that samples level 0
+                barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+                barrier.srcAccessMask = VK_ACCESS_2_NONE;
+                barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+                acquireBarriers.add(barrier);
+                return;
+            }
+            VkBufferMemoryBarrier2 barrier = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+                .srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                .dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+                .dstAccessMask = VK_ACCESS_2_NONE,
+                .srcQueueFamilyIndex = g_TransferQueueFamily,
+                .dstQueueFamilyIndex = g_QueueFamily,
+                .buffer = up.dst,
+                .offset = up.dst_offset,
+                .size = up.size,
+            };
+            releaseBarriers.add(barrier);
+            // buffers have no completion callback, so the acquire already makes the data visible to every consumer
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+            barrier.srcAccessMask = VK_ACCESS_2_NONE;
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+            acquireBarriers.add(barrier);
+        }
+
+        /**
+         * records every queued upload that fits. Each group of barriers goes out as one dependency: the transitions
+         * ahead of the copies, the ownership releases and acquires, and whatever the completion callbacks add to
+         * acquire_barriers()
+         */
+        void pump() {
+            if (!uploadBarriers.empty())
+                uploadBarriers.flush(upload_cb());
+            while (!queue.empty()) {
+                PendingUpload &up = queue.front();
+                if (!advance(up))
+                    break;
+                transfer_ownership(up);
+                finished.push_back(std::move(up));
+                queue.pop_front();
+            }
+            flush_image_copies();
+            if (finished.empty())
+                return;
+            releaseBarriers.flush(upload_cb());
+            acquireBarriers.flush(acquire_cb());
+            for (auto &up : finished) {
+                release(up);
+                if (up.on_uploaded)
+                    (*up.on_uploaded)();
+            }
+            finished.clear();
+            acquireBarriers.flush(acquire_cb());
+        }
+    }
+
+    void init() {
+        for (auto &segment : segments) {
+            VkBufferCreateInfo buffer_info = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .size = STAGING_RING_SIZE,
+                .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            };
+            VmaAllocationCreateInfo vmaInfo = {
+                .flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                .usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+            };
+            VmaAllocationInfo info;
+            if (vmaCreateBuffer(vma_allocator, &buffer_info, &vmaInfo, &segment.buffer, &segment.allocation, &info) != VK_SUCCESS) {
+                SDL_Log("[staging] Error: could not allocate staging ring");
+                panic();
+            }
+            segment.mapped = (uint8_t *)info.pMappedData;
+            segment.head = 0;
+        }
+        if (dedicated_transfer()) {
+            VkSemaphoreTypeCreateInfo type_info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+                .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+                .initialValue = 0,
+            };
+            VkSemaphoreCreateInfo semaphore_info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+                .pNext = &type_info,
+            };
+            if (vkCreateSemaphore(device, &semaphore_info, g_vk_Allocator, &transferSemaphore) != VK_SUCCESS) {
+                SDL_Log("[staging] Error: could not create transfer semaphore");
+                panic();
+            }
+            transferSubmitted = 0;
+        }
+    }
+    void shutdown() {
+        for (auto &up : queue)
+            release(up);
+        queue.clear();
+        for (auto &segment : segments) {
+            vmaDestroyBuffer(vma_allocator, segment.buffer, segment.allocation);
+            segment = {};
+        }
+        if (transferSemaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(device, transferSemaphore, g_vk_Allocator);
+            transferSemaphore = VK_NULL_HANDLE;
+        }
+    }
+    void begin_frame(uint32_t frame_slot) {
+        slot = frame_slot;
+        segments[slot].head = 0;
+    }
+
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, StagingRegion &out) {
+        Segment &segment = segments[slot];
+        const VkDeviceSize offset = align_up(segment.head, alignment);
+        if (offset + size > STAGING_RING_SIZE)
+            return false;
+        out = {segment.buffer, offset, size, segment.mapped + offset};
+        segment.head = offset + size;
+        return true;
+    }
+
+    VkCommandBuffer upload_cb() {
+        if (cb == VK_NULL_HANDLE) {
+            cb = make_transfer_cb_for_frame();
+            begin(cb);
+        }
+        return cb;
+    }
+    VkCommandBuffer acquire_cb() {
+        if (!dedicated_transfer())
+            return upload_cb();
+        if (acquireCb == VK_NULL_HANDLE) {
+            acquireCb = make_cb_for_frame();
+            begin(acquireCb);
+        }
+        return acquireCb;
+    }
+
+    barriers::BarrierBatch &upload_barriers() {
+        return uploadBarriers;
+    }
+    barriers::BarrierBatch &acquire_barriers() {
+        return acquireBarriers;
+    }
+
+    void upload_image(const ImageUpload &upload, DeferredCallback &&on_uploaded) {
+        queue.push_back({.is_image = true, .image = upload, .done = 0, .release = upload.release});
+        queue.back().on_uploaded.emplace(std::move(on_uploaded));
+    }
+    void upload_image(const ImageUpload &upload) {
+        queue.push_back({.is_image = true, .image = upload, .done = 0, .release = upload.release});
+    }
+    void upload_buffer(VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size,
+                       void (*release)(void *data)) {
+        queue.push_back({.is_image = false, .dst = dst, .dst_offset = dst_offset, .data = (const uint8_t *)data,
+                         .size = size, .done = 0, .release = release});
+    }
+
+    FrameUploads finish_frame() {
+        pump();
+        FrameUploads result = {VK_NULL_HANDLE, VK_NULL_HANDLE, 0};
+        if (cb == VK_NULL_HANDLE && acquireCb == VK_NULL_HANDLE)
+            return result;
+        vmaFlushAllocation(vma_allocator, segments[slot].allocation, 0, segments[slot].head);
+        if (!dedicated_transfer()) {
+            vkEndCommandBuffer(cb);
+            result.cb = cb;
+            cb = VK_NULL_HANDLE;
+            return result;
+        }
+        if (cb != VK_NULL_HANDLE) {
+            vkEndCommandBuffer(cb);
+            // the graphics submit waiting on this also signals the main timeline, retirement keys off that
+            const uint64_t value = transferSubmitted + 1;
+            VkTimelineSemaphoreSubmitInfo timeline_info = {
+                .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+                .signalSemaphoreValueCount = 1,
+                .pSignalSemaphoreValues = &value,
+            };
+            VkSubmitInfo info = {
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                .pNext = &timeline_info,
+                .commandBufferCount = 1,
+                .pCommandBuffers = &cb,
+                .signalSemaphoreCount = 1,
+                .pSignalSemaphores = &transferSemaphore,
+            };
+            VkResult err = vkQueueSubmit(g_TransferQueue, 1, &info, VK_NULL_HANDLE);
+            if (err != VK_SUCCESS) {
+                SDL_Log("[staging] Error: transfer vkQueueSubmit VkResult = %d", err);
+                panic();
+            }
+            transferSubmitted = value;
+            result.wait_semaphore = transferSemaphore;
+            result.wait_value = value;
+            cb = VK_NULL_HANDLE;
+        }
+        if (acquireCb != VK_NULL_HANDLE) {
+            vkEndCommandBuffer(acquireCb);
+            result.cb = acquireCb;
+            acquireCb = VK_NULL_HANDLE;
+        }
+        return result;
+    }
+    void submit_frame_uploads() {
+        FrameUploads uploads = finish_frame();
+        if (uploads.cb == VK_NULL_HANDLE && uploads.wait_semaphore == VK_NULL_HANDLE)
+            return;
+        const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        VkSubmitInfo info = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .waitSemaphoreCount = uploads.wait_semaphore != VK_NULL_HANDLE ? 1u : 0u,
+            .pWaitSemaphores = &uploads.wait_semaphore,
+            .pWaitDstStageMask = &wait_stage,
+            .commandBufferCount = uploads.cb != VK_NULL_HANDLE ? 1u : 0u,
+            .pCommandBuffers = &uploads.cb,
+        };
+        timeline::submit(g_Queue, info, VK_NULL_HANDLE, &uploads.wait_value);
+    }
+
+    StagingStats stats() {
+        return {segments[slot].head, STAGING_RING_SIZE, (uint32_t)queue.size()};
+    }
+}
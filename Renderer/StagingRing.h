@@ -0,0 +1,99 @@
+#ifndef STAGINGRING_H
+#define STAGINGRING_H
+#include <cstdint>
+#include <volk.h>
+#include <vk_mem_alloc.h>
+
+#include "Barriers.h"
+#include "ResourceManager.h"
+
+/**
+ * Persistently mapped staging memory, one STAGING_RING_SIZE segment per in-flight frame. Uploads are
+ * queued during the frame and recorded by finish_frame() as a memcpy into the current segment plus a copy
+ * command in the frame's upload command buffer, which is submitted ahead of the frame's rendering. Uploads
+ * that do not fit are split into chunks and continue in the next frames once their segment is free again.
+ * Recording them together lets each kind of barrier go out once per frame instead of once per upload, and
+ * uploads queued back to back for the same image, e.g. its levels and layers, share one copy command.
+ *
+ * With a dedicated transfer queue the copies run there and every finished upload is released to the
+ * graphics family. The matching acquire goes into acquire_cb(), submitted on g_Queue after waiting for
+ * the transfer submit.
+ */
+namespace renderer::staging {
+    struct StagingRegion {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint8_t *ptr;
+    };
+
+    struct ImageUpload {
+        VkImage image;
+        uint32_t width, height;
+        uint32_t texel_size;    // bytes per texel of the image format and of pixels, per block when compressed
+        uint32_t block_extent = 1; // texels along a block edge, 4 for BCn formats
+        uint32_t source_channels = 0; // 1 to 3 when pixels hold gray, gray alpha or RGB bytes for an RGBA8 image
+        uint32_t mip = 0;
+        uint32_t layer = 0;
+        const uint8_t *pixels;  // tightly packed rows, has to stay alive until release is called
+        void (*release)(void *pixels) = nullptr;
+        void *owner = nullptr;  // passed to release instead of pixels when pixels point into a larger allocation
+    };
+
+    void init();
+    void shutdown();
+    /// called by advance_frame_and_execute_cleanups once the slot's previous use finished on the GPU
+    void begin_frame(uint32_t frame_slot);
+
+    /**
+     * bump allocates from this frame's segment
+     * @return false when the segment is full, retry next frame
+     */
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, StagingRegion &out);
+
+    /// primary command buffer for this frame's copies, begun on first use, executes on g_TransferQueue
+    VkCommandBuffer upload_cb();
+    /**
+     * graphics queue command buffer that runs after this frame's copies, the same buffer as upload_cb()
+     * when there is no dedicated transfer queue
+     */
+    VkCommandBuffer acquire_cb();
+
+    /// transitions the copies need, e.g. into TRANSFER_DST_OPTIMAL, recorded in upload_cb() ahead of them
+    barriers::BarrierBatch &upload_barriers();
+    /// transitions after the copies, recorded in acquire_cb() once this frame's completion callbacks ran
+    barriers::BarrierBatch &acquire_barriers();
+
+    /**
+     * copies pixels into image, whose mip and layer must already be in TRANSFER_DST_OPTIMAL when upload_cb() executes
+     * @param on_uploaded runs after the last chunk was recorded, when the subresource is owned by the graphics
+     * family in acquire_cb(), usually to transition the image there
+     */
+    void upload_image(const ImageUpload &upload, DeferredCallback &&on_uploaded);
+    void upload_image(const ImageUpload &upload);
+    /// data has to stay alive until release is called
+    void upload_buffer(VkBuffer dst, VkDeviceSize dst_offset, const void *data, VkDeviceSize size,
+                       void (*release)(void *data) = nullptr);
+
+    struct FrameUploads {
+        VkCommandBuffer cb;         // graphics queue part, VK_NULL_HANDLE if nothing was uploaded
+        VkSemaphore wait_semaphore; // transfer timeline the graphics submit has to wait on, or VK_NULL_HANDLE
+        uint64_t wait_value;
+    };
+    /**
+     * records queued chunks that fit, ends and flushes this frame's upload buffers and submits the copies
+     * to the transfer queue if there is a dedicated one
+     * @return what to submit before the frame's own commands
+     */
+    FrameUploads finish_frame();
+    /// finish_frame() plus a submit of its own, for frames that never reach FrameRender
+    void submit_frame_uploads();
+
+    struct StagingStats {
+        VkDeviceSize used;      // bytes handed out from this frame's segment
+        VkDeviceSize capacity;
+        uint32_t queued;        // uploads waiting for space
+    };
+    StagingStats stats();
+}
+#endif //STAGINGRING_H
@@ -0,0 +1,236 @@
+#include "Swapchain.h"
+#include <algorithm>
+#include <vector>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_timer.h>
+
+#include "FramePacing.h"
+#include "Renderer.h"
+#include "ResourceManager.h"
+#include "../debug_panic.h"
+#include "../love_profiler.h"
+
+namespace renderer::swapchain {
+    namespace {
+        // what a recreate replaced, kept until an image of a newer swapchain has been acquired
+        struct Retired {
+            VkSwapchainKHR swapchain;
+            std::vector<SwapchainFrame> frames;
+            std::vector<VkSemaphore> acquireSemaphores;
+        };
+
+        VkSurfaceKHR surfaceHandle = VK_NULL_HANDLE;
+        VkSurfaceFormatKHR surfaceFormat = {};
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        uint32_t extentWidth = 0, extentHeight = 0;
+        std::vector<SwapchainFrame> frames;
+        // one more than images so vkAcquireNextImageKHR always has a semaphore nothing is waiting on
+        std::vector<VkSemaphore> acquireSemaphores;
+        uint32_t semaphoreIndex = 0;
+        std::vector<Retired> retired;
+        uint32_t imageIndex = 0;
+        bool acquired = false;
+        RecreateStats recreateStats = {};
+        float recreateTotalMs = 0;
+
+        void check(VkResult err, const char *what) {
+            if (err == VK_SUCCESS)
+                return;
+            SDL_Log("[swapchain] Error: %s VkResult = %d", what, err);
+            panic();
+        }
+
+        void create_frame(SwapchainFrame &frame, VkImage image) {
+            frame.image = image;
+            VkImageViewCreateInfo view_info = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+                .image = image,
+                .viewType = VK_IMAGE_VIEW_TYPE_2D,
+                .format = surfaceFormat.format,
+                .components = {VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_A},
+                .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+            };
+            check(vkCreateImageView(device, &view_info, g_vk_Allocator, &frame.view), "vkCreateImageView");
+            VkCommandPoolCreateInfo pool_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .queueFamilyIndex = g_QueueFamily,
+            };
+            check(vkCreateCommandPool(device, &pool_info, g_vk_Allocator, &frame.command_pool), "vkCreateCommandPool");
+            VkCommandBufferAllocateInfo cb_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                .commandPool = frame.command_pool,
+                .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                .commandBufferCount = 1,
+            };
+            check(vkAllocateCommandBuffers(device, &cb_info, &frame.command_buffer), "vkAllocateCommandBuffers");
+            VkFenceCreateInfo fence_info = {
+                .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+                .flags = VK_FENCE_CREATE_SIGNALED_BIT,
+            };
+            check(vkCreateFence(device, &fence_info, g_vk_Allocator, &frame.fence), "vkCreateFence");
+            VkSemaphoreCreateInfo semaphore_info = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+            check(vkCreateSemaphore(device, &semaphore_info, g_vk_Allocator, &frame.render_complete), "vkCreateSemaphore");
+        }
+
+        void destroy(VkSwapchainKHR old, const std::vector<SwapchainFrame> &oldFrames, const std::vector<VkSemaphore> &oldSemaphores) {
+            for (const auto &frame : oldFrames) {
+                vkDestroySemaphore(device, frame.render_complete, g_vk_Allocator);
+                vkDestroyFence(device, frame.fence, g_vk_Allocator);
+                vkDestroyCommandPool(device, frame.command_pool, g_vk_Allocator);
+                vkDestroyImageView(device, frame.view, g_vk_Allocator);
+            }
+            for (VkSemaphore semaphore : oldSemaphores)
+                vkDestroySemaphore(device, semaphore, g_vk_Allocator);
+            vkDestroySwapchainKHR(device, old, g_vk_Allocator);
+        }
+
+        void create(uint32_t width, uint32_t height) {
+            VkSurfaceCapabilitiesKHR caps;
+            check(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(g_PhysicalDevice, surfaceHandle, &caps), "vkGetPhysicalDeviceSurfaceCapabilitiesKHR");
+            uint32_t min_images = std::max(g_MinImageCount, caps.minImageCount);
+            if (caps.maxImageCount != 0)
+                min_images = std::min(min_images, caps.maxImageCount);
+            // 0xFFFFFFFF means the surface size follows the swapchain
+            if (caps.currentExtent.width != 0xFFFFFFFF) {
+                width = caps.currentExtent.width;
+                height = caps.currentExtent.height;
+            }
+            presentMode = pacing::select_present_mode(surfaceHandle);
+
+            VkSwapchainKHR old = swapchain;
+            VkSwapchainCreateInfoKHR info = {
+                .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+                .surface = surfaceHandle,
+                .minImageCount = min_images,
+                .imageFormat = surfaceFormat.format,
+                .imageColorSpace = surfaceFormat.colorSpace,
+                .imageExtent = {width, height},
+                .imageArrayLayers = 1,
+                .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+                .preTransform = (caps.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR) ? VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR : caps.currentTransform,
+                .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+                .presentMode = presentMode,
+                .clipped = VK_TRUE,
+                .oldSwapchain = old,
+            };
+            check(vkCreateSwapchainKHR(device, &info, g_vk_Allocator, &swapchain), "vkCreateSwapchainKHR");
+            extentWidth = width;
+            extentHeight = height;
+
+            // the old swapchain's presents may still wait on its render_complete semaphores, and only acquiring an
+            // image of the new one shows they were consumed, acquire() hands them to deferffl then
+            if (old != VK_NULL_HANDLE)
+                retired.push_back({old, std::move(frames), std::move(acquireSemaphores)});
+
+            uint32_t count = 0;
+            check(vkGetSwapchainImagesKHR(device, swapchain, &count, nullptr), "vkGetSwapchainImagesKHR");
+            std::vector<VkImage> images(count);
+            check(vkGetSwapchainImagesKHR(device, swapchain, &count, images.data()), "vkGetSwapchainImagesKHR");
+            frames.assign(count, {});
+            for (uint32_t i = 0; i < count; i++)
+                create_frame(frames[i], images[i]);
+            acquireSemaphores.assign(count + 1, VK_NULL_HANDLE);
+            VkSemaphoreCreateInfo semaphore_info = {.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+            for (VkSemaphore &semaphore : acquireSemaphores)
+                check(vkCreateSemaphore(device, &semaphore_info, g_vk_Allocator, &semaphore), "vkCreateSemaphore");
+            semaphoreIndex = 0;
+            acquired = false;
+        }
+    }
+
+    void init(VkSurfaceKHR surface, uint32_t width, uint32_t height) {
+        surfaceHandle = surface;
+        VkBool32 supported = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(g_PhysicalDevice, g_QueueFamily, surface, &supported);
+        if (supported != VK_TRUE) {
+            SDL_Log("[swapchain] Error: the graphics queue family cannot present to the window surface");
+            panic();
+        }
+        const VkFormat formats[] = {VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8_UNORM, VK_FORMAT_R8G8B8_UNORM};
+        surfaceFormat = ImGui_ImplVulkanH_SelectSurfaceFormat(g_PhysicalDevice, surface, formats, (size_t)IM_ARRAYSIZE(formats),
+                                                              VK_COLORSPACE_SRGB_NONLINEAR_KHR);
+        IM_ASSERT(g_MinImageCount >= 2);
+        create(width, height);
+    }
+    void shutdown() {
+        for (const auto &old : retired)
+            destroy(old.swapchain, old.frames, old.acquireSemaphores);
+        retired.clear();
+        destroy(swapchain, frames, acquireSemaphores);
+        frames.clear();
+        acquireSemaphores.clear();
+        swapchain = VK_NULL_HANDLE;
+        vkDestroySurfaceKHR(vk_Instance, surfaceHandle, g_vk_Allocator);
+        surfaceHandle = VK_NULL_HANDLE;
+    }
+
+    void recreate(uint32_t width, uint32_t height) {
+        LOVE_ZONE("Swapchain recreate");
+        const uint64_t start = SDL_GetTicksNS();
+        create(width, height);
+        const float elapsed = (float)(SDL_GetTicksNS() - start) / 1e6f;
+        recreateStats.count++;
+        recreateStats.last_ms = elapsed;
+        recreateStats.max_ms = std::max(recreateStats.max_ms, elapsed);
+        recreateTotalMs += elapsed;
+        recreateStats.avg_ms = recreateTotalMs / (float)recreateStats.count;
+    }
+
+    bool acquire(AcquiredFrame &out) {
+        const VkSemaphore image_acquired = acquireSemaphores[semaphoreIndex];
+        VkResult err = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, image_acquired, VK_NULL_HANDLE, &imageIndex);
+        if (err == VK_ERROR_OUT_OF_DATE_KHR) {
+            g_SwapChainRebuild = true;
+            return false;
+        }
+        // a suboptimal image is still acquired and its semaphore signaled, render and present it, rebuild after
+        if (err == VK_SUBOPTIMAL_KHR)
+            g_SwapChainRebuild = true;
+        else
+            check(err, "vkAcquireNextImageKHR");
+        acquired = true;
+        // frames already submitted against the retired swapchains still use them, deferffl waits for those
+        for (auto &entry : retired) {
+            deferffl([old = std::move(entry)] {
+                destroy(old.swapchain, old.frames, old.acquireSemaphores);
+            });
+        }
+        retired.clear();
+        // the image's last present waited on its render_complete, getting the image back means that wait is over
+        out = {&frames[imageIndex], image_acquired, frames[imageIndex].render_complete};
+        return true;
+    }
+    void present() {
+        if (!acquired)
+            return;
+        acquired = false;
+        VkPresentInfoKHR info = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &frames[imageIndex].render_complete,
+            .swapchainCount = 1,
+            .pSwapchains = &swapchain,
+            .pImageIndices = &imageIndex,
+        };
+        VkResult err;
+        {
+            LOVE_ZONE("Present");
+            err = vkQueuePresentKHR(g_Queue, &info);
+        }
+        if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
+            g_SwapChainRebuild = true;
+        else
+            check(err, "vkQueuePresentKHR");
+        semaphoreIndex = (semaphoreIndex + 1) % (uint32_t)acquireSemaphores.size();
+    }
+
+    VkSurfaceKHR surface() { return surfaceHandle; }
+    VkSurfaceFormatKHR surface_format() { return surfaceFormat; }
+    VkPresentModeKHR present_mode() { return presentMode; }
+    uint32_t width() { return extentWidth; }
+    uint32_t height() { return extentHeight; }
+    uint32_t image_count() { return (uint32_t)frames.size(); }
+    RecreateStats recreate_stats() { return recreateStats; }
+}
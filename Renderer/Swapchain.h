@@ -0,0 +1,59 @@
+#ifndef SWAPCHAIN_H
+#define SWAPCHAIN_H
+#include <cstdint>
+#include <volk.h>
+
+/**
+ * Window swapchain that replaces ImGui_ImplVulkanH_CreateOrResizeWindow. Recreation passes the old swapchain
+ * as oldSwapchain and never waits for the device: once an image of the new swapchain is acquired, the old
+ * swapchain, its views and per-image command pools, fences and semaphores go through deferffl, so frames already
+ * in flight finish on them while new frames use the new images.
+ */
+namespace renderer::swapchain {
+    /// one per swapchain image, FrameRender waits on the fence before reusing the command pool
+    struct SwapchainFrame {
+        VkImage image;
+        VkImageView view;
+        VkCommandPool command_pool;
+        VkCommandBuffer command_buffer;
+        VkFence fence;
+        VkSemaphore render_complete;    // waited on by this image's present, reused when the image is acquired again
+    };
+    struct AcquiredFrame {
+        SwapchainFrame *frame;
+        VkSemaphore image_acquired;
+        VkSemaphore render_complete;
+    };
+
+    /// picks the surface format and present mode and builds the first swapchain, takes ownership of surface
+    void init(VkSurfaceKHR surface, uint32_t width, uint32_t height);
+    /// destroys the swapchain and the surface, device must be idle and deferred cleanups flushed
+    void shutdown();
+    /// new swapchain at the given size with the current g_MinImageCount and pacing present mode
+    void recreate(uint32_t width, uint32_t height);
+
+    /**
+     * acquires the next image, sets g_SwapChainRebuild when the swapchain is out of date or suboptimal
+     * @return false when nothing was acquired, the frame has to be skipped then
+     */
+    bool acquire(AcquiredFrame &out);
+    /// presents the image from the last successful acquire, does nothing if there was none
+    void present();
+
+    VkSurfaceKHR surface();
+    VkSurfaceFormatKHR surface_format();
+    VkPresentModeKHR present_mode();
+    uint32_t width();
+    uint32_t height();
+    uint32_t image_count();
+
+    struct RecreateStats {
+        uint32_t count;
+        float last_ms;
+        float avg_ms;
+        float max_ms;
+    };
+    /// CPU time spent in recreate(), the GPU keeps running meanwhile
+    RecreateStats recreate_stats();
+}
+#endif //SWAPCHAIN_H
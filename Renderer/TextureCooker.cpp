@@ -0,0 +1,777 @@
+#include "TextureCooker.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <SDL3/SDL_filesystem.h>
+#include <SDL3/SDL_log.h>
+#include <SDL3/SDL_stdinc.h>
+#if defined(__SSE2__) || defined(_M_X64)
+#define COOK_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "renderer_constants.h"
+#include "../love_worker_pool.h"
+#include "../love_profiler.h"
+
+namespace renderer::cook {
+    namespace {
+        // in front of the blocks of every cache entry
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t key;
+            uint32_t format;
+            uint32_t width, height;
+            uint32_t mipcount;
+            uint64_t data_size;
+            uint8_t quality;
+            uint8_t mips;
+            uint8_t reserved[6];
+        };
+        constexpr uint32_t file_magic = 0x4354564c; // "LVTC"
+        // bump whenever the encoders or the mip filter change, older entries are cooked again
+        constexpr uint32_t file_version = 1;
+
+        std::string directory;
+        std::unique_ptr<WorkerPool> encoders;
+        std::atomic<Quality> currentQuality = Quality::Best;
+        std::atomic<uint32_t> temporaryCount = 0;
+
+        std::atomic<uint32_t> cookedCount = 0, hitCount = 0;
+        std::atomic<uint64_t> cookMicros = 0, sourceBytes = 0, cookedBytes = 0;
+
+        float srgbToLinear[256];
+        uint8_t linearToSrgb[4096];
+
+        void build_tables() {
+            for (int i = 0; i < 256; i++) {
+                const float c = i / 255.0f;
+                srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 4096; i++) {
+                const float l = i / 4095.0f;
+                const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                linearToSrgb[i] = (uint8_t)std::clamp((int)(c * 255.0f + 0.5f), 0, 255);
+            }
+        }
+
+        std::string entry_path(uint64_t key, Quality quality, bool mips) {
+            char name[40];
+            snprintf(name, sizeof(name), "%016llx-%u%u.bct", (unsigned long long)key, (unsigned)quality, (unsigned)mips);
+            return directory + name;
+        }
+
+        uint32_t block_bytes(VkFormat format) {
+            return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? 8 : 16;
+        }
+
+        // the formats cook() writes, nothing else may come back out of the cache
+        bool cooked_format(VkFormat format) {
+            return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK ||
+                   format == VK_FORMAT_BC7_SRGB_BLOCK;
+        }
+
+        uint32_t chain_length(uint32_t width, uint32_t height, bool mips) {
+            return mips ? std::min<uint32_t>((uint32_t)std::bit_width(std::max(width, height)), MAX_IMAGE_MIPS) : 1;
+        }
+
+        uint64_t chain_bytes(VkFormat format, uint32_t width, uint32_t height, uint32_t mipcount) {
+            uint64_t bytes = 0;
+            for (uint32_t level = 0; level < mipcount; level++)
+                bytes += level_size(format, std::max(width >> level, 1u), std::max(height >> level, 1u));
+            return bytes;
+        }
+
+        // ---- mip chain ----
+
+        // 2x2 box filter in linear space, odd edges repeat their last texel
+        void downsample(const uint8_t *src, uint32_t width, uint32_t height, uint8_t *dst) {
+            const uint32_t dst_width = std::max(width / 2, 1u), dst_height = std::max(height / 2, 1u);
+            for (uint32_t y = 0; y < dst_height; y++) {
+                const uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+                for (uint32_t x = 0; x < dst_width; x++) {
+                    const uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+                    const uint8_t *t[4] = {
+                        src + ((size_t)y0 * width + x0) * 4, src + ((size_t)y0 * width + x1) * 4,
+                        src + ((size_t)y1 * width + x0) * 4, src + ((size_t)y1 * width + x1) * 4,
+                    };
+                    uint8_t *out = dst + ((size_t)y * dst_width + x) * 4;
+                    for (int c = 0; c < 3; c++) {
+                        const float l = (srgbToLinear[t[0][c]] + srgbToLinear[t[1][c]] + srgbToLinear[t[2][c]] +
+                                         srgbToLinear[t[3][c]]) * 0.25f;
+                        out[c] = linearToSrgb[(int)(l * 4095.0f + 0.5f)];
+                    }
+                    out[3] = (uint8_t)((t[0][3] + t[1][3] + t[2][3] + t[3][3] + 2) / 4);
+                }
+            }
+        }
+
+        // ---- block encoders ----
+
+        using Block = float[16][4];
+
+        void fetch_block(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, Block out) {
+            for (uint32_t i = 0; i < 16; i++) {
+                const uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+                const uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+                const uint8_t *t = rgba + ((size_t)y * width + x) * 4;
+                for (int c = 0; c < 4; c++)
+                    out[i][c] = t[c];
+            }
+        }
+
+#if defined(COOK_SSE2) || defined(__ARM_NEON)
+        // the index searches run on four texels at once, one lane per texel. SSE2 is part of x86-64, so unlike the
+        // staging ring's shuffles this needs no runtime check. Sums keep the scalar order and the results are identical
+#if defined(COOK_SSE2)
+        using Lanes = __m128;
+
+        Lanes splat(float v) {
+            return _mm_set1_ps(v);
+        }
+        void store(float out[4], Lanes v) {
+            _mm_storeu_ps(out, v);
+        }
+        // texels first to first + 3, one register per channel
+        void load_texels(const Block px, int first, Lanes out[4]) {
+            for (int k = 0; k < 4; k++)
+                out[k] = _mm_loadu_ps(px[first + k]);
+            _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+        }
+        Lanes distance2(const Lanes texels[4], const float *colour, int channels) {
+            Lanes d = _mm_setzero_ps();
+            for (int c = 0; c < channels; c++) {
+                const Lanes x = _mm_sub_ps(texels[c], _mm_set1_ps(colour[c]));
+                d = _mm_add_ps(d, _mm_mul_ps(x, x));
+            }
+            return d;
+        }
+        Lanes abs_distance(Lanes x, float value) {
+            return _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(x, _mm_set1_ps(value)));
+        }
+        // lanes strictly nearer than best take d and index, ties keep the earlier candidate
+        void keep_nearer(Lanes d, float index, Lanes &best, Lanes &best_index) {
+            const Lanes nearer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            best_index = _mm_or_ps(_mm_and_ps(nearer, _mm_set1_ps(index)), _mm_andnot_ps(nearer, best_index));
+        }
+#else
+        using Lanes = float32x4_t;
+
+        Lanes splat(float v) {
+            return vdupq_n_f32(v);
+        }
+        void store(float out[4], Lanes v) {
+            vst1q_f32(out, v);
+        }
+        void load_texels(const Block px, int first, Lanes out[4]) {
+            const float32x4x4_t texels = vld4q_f32(px[first]);
+            for (int c = 0; c < 4; c++)
+                out[c] = texels.val[c];
+        }
+        Lanes distance2(const Lanes texels[4], const float *colour, int channels) {
+            Lanes d = vdupq_n_f32(0.0f);
+            for (int c = 0; c < channels; c++) {
+                const Lanes x = vsubq_f32(texels[c], vdupq_n_f32(colour[c]));
+                d = vaddq_f32(d, vmulq_f32(x, x));
+            }
+            return d;
+        }
+        Lanes abs_distance(Lanes x, float value) {
+            return vabsq_f32(vsubq_f32(x, vdupq_n_f32(value)));
+        }
+        void keep_nearer(Lanes d, float index, Lanes &best, Lanes &best_index) {
+            const uint32x4_t nearer = vcltq_f32(d, best);
+            best = vbslq_f32(nearer, d, best);
+            best_index = vbslq_f32(nearer, vdupq_n_f32(index), best_index);
+        }
+#endif
+#endif
+
+        /**
+         * endpoints along the block's principal axis over the first channels components, pulled in by 1/16 of
+         * their distance since the extremes are rarely hit exactly
+         */
+        void principal_endpoints(const Block px, int channels, float e0[4], float e1[4]) {
+            float mean[4] = {};
+            for (int i = 0; i < 16; i++)
+                for (int c = 0; c < channels; c++)
+                    mean[c] += px[i][c] * (1.0f / 16.0f);
+            float cov[4][4] = {};
+            for (int i = 0; i < 16; i++)
+                for (int a = 0; a < channels; a++)
+                    for (int b = 0; b < channels; b++)
+                        cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+            // only a block without any variance is flat, colour can vary while luma stays constant
+            float trace = 0;
+            int widest = 0;
+            for (int c = 0; c < channels; c++) {
+                trace += cov[c][c];
+                if (cov[c][c] > cov[widest][widest])
+                    widest = c;
+            }
+            if (trace < 1e-3f) {
+                for (int c = 0; c < 4; c++)
+                    e0[c] = e1[c] = mean[c];
+                return;
+            }
+            // power iteration from the channel with the most variance, converges in a few steps for 16 points
+            float axis[4] = {};
+            axis[widest] = 1.0f;
+            for (int iteration = 0; iteration < 6; iteration++) {
+                float next[4] = {};
+                for (int a = 0; a < channels; a++)
+                    for (int b = 0; b < channels; b++)
+                        next[a] += cov[a][b] * axis[b];
+                float length = 0;
+                for (int c = 0; c < channels; c++)
+                    length = std::max(length, std::fabs(next[c]));
+                if (length < 1e-6f * trace) {
+                    // collapsed, fall back to the bounding box diagonal, oriented by how each channel follows the widest one
+                    for (int c = 0; c < channels; c++) {
+                        float lo = 255.0f, hi = 0.0f;
+                        for (int i = 0; i < 16; i++) {
+                            lo = std::min(lo, px[i][c]);
+                            hi = std::max(hi, px[i][c]);
+                        }
+                        axis[c] = cov[c][widest] < 0 ? lo - hi : hi - lo;
+                    }
+                    break;
+                }
+                for (int c = 0; c < channels; c++)
+                    axis[c] = next[c] / length;
+            }
+            float t_min = 1e30f, t_max = -1e30f;
+            for (int i = 0; i < 16; i++) {
+                float t = 0;
+                for (int c = 0; c < channels; c++)
+                    t += (px[i][c] - mean[c]) * axis[c];
+                t_min = std::min(t_min, t);
+                t_max = std::max(t_max, t);
+            }
+            const float inset = (t_max - t_min) / 16.0f;
+            t_min += inset;
+            t_max -= inset;
+            float length2 = 0;
+            for (int c = 0; c < channels; c++)
+                length2 += axis[c] * axis[c];
+            for (int c = 0; c < channels; c++) {
+                e0[c] = std::clamp(mean[c] + axis[c] * t_min / length2, 0.0f, 255.0f);
+                e1[c] = std::clamp(mean[c] + axis[c] * t_max / length2, 0.0f, 255.0f);
+            }
+        }
+
+        /**
+         * least squares endpoints for fixed interpolation weights, w[i] is how far texel i sits from e0 towards e1
+         * @return false when the weights do not pin down both endpoints
+         */
+        bool refit(const Block px, const float w[16], int channels, float e0[4], float e1[4]) {
+            float a = 0, b = 0, c = 0, x0[4] = {}, x1[4] = {};
+            for (int i = 0; i < 16; i++) {
+                const float u = 1.0f - w[i];
+                a += u * u;
+                b += u * w[i];
+                c += w[i] * w[i];
+                for (int k = 0; k < channels; k++) {
+                    x0[k] += u * px[i][k];
+                    x1[k] += w[i] * px[i][k];
+                }
+            }
+            const float d = a * c - b * b;
+            if (std::fabs(d) < 1e-6f)
+                return false;
+            for (int k = 0; k < channels; k++) {
+                e0[k] = std::clamp((c * x0[k] - b * x1[k]) / d, 0.0f, 255.0f);
+                e1[k] = std::clamp((a * x1[k] - b * x0[k]) / d, 0.0f, 255.0f);
+            }
+            return true;
+        }
+
+        uint16_t pack565(const float e[4]) {
+            const int r = (int)(e[0] * 31.0f / 255.0f + 0.5f), g = (int)(e[1] * 63.0f / 255.0f + 0.5f),
+                      b = (int)(e[2] * 31.0f / 255.0f + 0.5f);
+            return (uint16_t)(r << 11 | g << 5 | b);
+        }
+        void unpack565(uint16_t c, float out[3]) {
+            const int r = c >> 11 & 31, g = c >> 5 & 63, b = c & 31;
+            out[0] = (float)(r << 3 | r >> 2);
+            out[1] = (float)(g << 2 | g >> 4);
+            out[2] = (float)(b << 3 | b >> 2);
+        }
+
+        // indices for fixed 565 endpoints in four color mode, returns the squared error
+        float bc1_indices(const Block px, uint16_t c0, uint16_t c1, uint32_t &indices) {
+            float palette[4][3];
+            unpack565(c0, palette[0]);
+            unpack565(c1, palette[1]);
+            for (int c = 0; c < 3; c++) {
+                palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+                palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+            }
+            float error = 0;
+            indices = 0;
+#if defined(COOK_SSE2) || defined(__ARM_NEON)
+            for (int i = 0; i < 16; i += 4) {
+                Lanes texels[4];
+                load_texels(px, i, texels);
+                Lanes best = splat(1e30f), index = splat(0.0f);
+                for (int p = 0; p < 4; p++)
+                    keep_nearer(distance2(texels, palette[p], 3), (float)p, best, index);
+                float best_out[4], index_out[4];
+                store(best_out, best);
+                store(index_out, index);
+                for (int k = 0; k < 4; k++) {
+                    indices |= (uint32_t)index_out[k] << ((i + k) * 2);
+                    error += best_out[k];
+                }
+            }
+#else
+            for (int i = 0; i < 16; i++) {
+                float best = 1e30f;
+                uint32_t index = 0;
+                for (uint32_t p = 0; p < 4; p++) {
+                    float d = 0;
+                    for (int c = 0; c < 3; c++)
+                        d += (px[i][c] - palette[p][c]) * (px[i][c] - palette[p][c]);
+                    if (d < best) {
+                        best = d;
+                        index = p;
+                    }
+                }
+                indices |= index << (i * 2);
+                error += best;
+            }
+#endif
+            return error;
+        }
+
+        // the color half of BC1 and BC3, always in four color mode
+        void encode_bc1(const Block px, uint8_t out[8]) {
+            float e0[4], e1[4];
+            principal_endpoints(px, 3, e0, e1);
+            uint16_t c0 = pack565(e1), c1 = pack565(e0);
+            uint32_t indices;
+            float error = bc1_indices(px, c0, c1, indices);
+            // one least squares pass over the chosen indices, kept only if it helps
+            static constexpr float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+            float w[16];
+            for (int i = 0; i < 16; i++)
+                w[i] = weights[indices >> (i * 2) & 3];
+            float r0[4], r1[4];
+            if (refit(px, w, 3, r0, r1)) {
+                const uint16_t n0 = pack565(r0), n1 = pack565(r1);
+                uint32_t refit_indices;
+                const float refit_error = bc1_indices(px, n0, n1, refit_indices);
+                if (refit_error < error) {
+                    c0 = n0;
+                    c1 = n1;
+                    indices = refit_indices;
+                }
+            }
+            // four color mode needs c0 > c1, swapping the endpoints swaps indices 0/1 and 2/3
+            if (c0 < c1) {
+                std::swap(c0, c1);
+                indices ^= 0x55555555;
+            } else if (c0 == c1) {
+                indices = 0;
+            }
+            out[0] = (uint8_t)c0;
+            out[1] = (uint8_t)(c0 >> 8);
+            out[2] = (uint8_t)c1;
+            out[3] = (uint8_t)(c1 >> 8);
+            memcpy(out + 4, &indices, 4);
+        }
+
+        // BC4 style alpha in eight value mode
+        void encode_bc3_alpha(const Block px, uint8_t out[8]) {
+            float lo = 255.0f, hi = 0.0f;
+            for (int i = 0; i < 16; i++) {
+                lo = std::min(lo, px[i][3]);
+                hi = std::max(hi, px[i][3]);
+            }
+            const uint8_t a0 = (uint8_t)(hi + 0.5f), a1 = (uint8_t)(lo + 0.5f);
+            out[0] = a0;
+            out[1] = a1;
+            uint64_t bits = 0;
+            if (a0 > a1) {
+                float palette[8] = {(float)a0, (float)a1};
+                for (int k = 1; k < 7; k++)
+                    palette[k + 1] = ((7 - k) * a0 + k * a1) / 7.0f;
+#if defined(COOK_SSE2) || defined(__ARM_NEON)
+                for (int i = 0; i < 16; i += 4) {
+                    Lanes texels[4];
+                    load_texels(px, i, texels);
+                    Lanes best = splat(1e30f), index = splat(0.0f);
+                    for (int p = 0; p < 8; p++)
+                        keep_nearer(abs_distance(texels[3], palette[p]), (float)p, best, index);
+                    float index_out[4];
+                    store(index_out, index);
+                    for (int k = 0; k < 4; k++)
+                        bits |= (uint64_t)index_out[k] << ((i + k) * 3);
+                }
+#else
+                for (int i = 0; i < 16; i++) {
+                    uint64_t index = 0;
+                    float best = 1e30f;
+                    for (uint64_t p = 0; p < 8; p++) {
+                        const float d = std::fabs(px[i][3] - palette[p]);
+                        if (d < best) {
+                            best = d;
+                            index = p;
+                        }
+                    }
+                    bits |= index << (i * 3);
+                }
+#endif
+            }
+            for (int k = 0; k < 6; k++)
+                out[2 + k] = (uint8_t)(bits >> (k * 8));
+        }
+
+        void encode_bc3(const Block px, uint8_t out[16]) {
+            encode_bc3_alpha(px, out);
+            encode_bc1(px, out + 8);
+        }
+
+        constexpr int bc7_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        struct Bc7Endpoints {
+            uint8_t q[2][4];    // 7 bit components
+            uint8_t p[2];       // shared lsb of each endpoint
+        };
+
+        // the best 7 bit values and p bit for one endpoint, all four components share the p bit
+        void quantize_bc7(const float e[4], uint8_t q[4], uint8_t &p) {
+            float best = 1e30f;
+            for (uint8_t bit = 0; bit < 2; bit++) {
+                uint8_t candidate[4];
+                float error = 0;
+                for (int c = 0; c < 4; c++) {
+                    const int v = std::clamp((int)((e[c] - bit) / 2.0f + 0.5f), 0, 127);
+                    candidate[c] = (uint8_t)v;
+                    const float d = e[c] - (float)(v << 1 | bit);
+                    error += d * d;
+                }
+                if (error < best) {
+                    best = error;
+                    p = bit;
+                    memcpy(q, candidate, 4);
+                }
+            }
+        }
+
+        float bc7_indices(const Block px, const Bc7Endpoints &ep, uint8_t indices[16]) {
+            int e[2][4];
+            for (int k = 0; k < 2; k++)
+                for (int c = 0; c < 4; c++)
+                    e[k][c] = ep.q[k][c] << 1 | ep.p[k];
+            float palette[16][4];
+            for (int w = 0; w < 16; w++)
+                for (int c = 0; c < 4; c++)
+                    palette[w][c] = (float)(((64 - bc7_weights[w]) * e[0][c] + bc7_weights[w] * e[1][c] + 32) >> 6);
+            float error = 0;
+#if defined(COOK_SSE2) || defined(__ARM_NEON)
+            for (int i = 0; i < 16; i += 4) {
+                Lanes texels[4];
+                load_texels(px, i, texels);
+                Lanes best = splat(1e30f), index = splat(0.0f);
+                for (int w = 0; w < 16; w++)
+                    keep_nearer(distance2(texels, palette[w], 4), (float)w, best, index);
+                float best_out[4], index_out[4];
+                store(best_out, best);
+                store(index_out, index);
+                for (int k = 0; k < 4; k++) {
+                    indices[i + k] = (uint8_t)index_out[k];
+                    error += best_out[k];
+                }
+            }
+#else
+            for (int i = 0; i < 16; i++) {
+                float best = 1e30f;
+                for (int w = 0; w < 16; w++) {
+                    float d = 0;
+                    for (int c = 0; c < 4; c++)
+                        d += (px[i][c] - palette[w][c]) * (px[i][c] - palette[w][c]);
+                    if (d < best) {
+                        best = d;
+                        indices[i] = (uint8_t)w;
+                    }
+                }
+                error += best;
+            }
+#endif
+            return error;
+        }
+
+        struct BitWriter {
+            uint64_t words[2] = {};
+            uint32_t position = 0;
+
+            void put(uint64_t value, uint32_t count) {
+                for (uint32_t i = 0; i < count; i++, position++)
+                    words[position >> 6] |= (value >> i & 1) << (position & 63);
+            }
+        };
+
+        // mode 6: one subset, RGBA endpoints with 7 bits plus a p bit, 4 bit indices
+        void encode_bc7(const Block px, uint8_t out[16]) {
+            float e0[4], e1[4];
+            principal_endpoints(px, 4, e0, e1);
+            Bc7Endpoints ep;
+            quantize_bc7(e0, ep.q[0], ep.p[0]);
+            quantize_bc7(e1, ep.q[1], ep.p[1]);
+            uint8_t indices[16];
+            float error = bc7_indices(px, ep, indices);
+
+            float w[16];
+            for (int i = 0; i < 16; i++)
+                w[i] = bc7_weights[indices[i]] / 64.0f;
+            float r0[4], r1[4];
+            if (refit(px, w, 4, r0, r1)) {
+                Bc7Endpoints refit_ep;
+                quantize_bc7(r0, refit_ep.q[0], refit_ep.p[0]);
+                quantize_bc7(r1, refit_ep.q[1], refit_ep.p[1]);
+                uint8_t refit_indices[16];
+                const float refit_error = bc7_indices(px, refit_ep, refit_indices);
+                if (refit_error < error) {
+                    ep = refit_ep;
+                    memcpy(indices, refit_indices, 16);
+                }
+            }
+            // the anchor index is stored without its top bit, flip the endpoints when texel 0 needs it
+            if (indices[0] & 8) {
+                std::swap(ep.q[0], ep.q[1]);
+                std::swap(ep.p[0], ep.p[1]);
+                for (auto &index : indices)
+                    index = 15 - index;
+            }
+
+            BitWriter bits;
+            bits.put(1 << 6, 7);
+            for (int c = 0; c < 4; c++) {
+                bits.put(ep.q[0][c], 7);
+                bits.put(ep.q[1][c], 7);
+            }
+            bits.put(ep.p[0], 1);
+            bits.put(ep.p[1], 1);
+            bits.put(indices[0], 3);
+            for (int i = 1; i < 16; i++)
+                bits.put(indices[i], 4);
+            memcpy(out, bits.words, 16);
+        }
+
+        void encode_level(const uint8_t *rgba, uint32_t width, uint32_t height, VkFormat format, uint8_t *out) {
+            const uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+            const uint32_t stride = block_bytes(format);
+            // rows of blocks are independent, small levels stay on the calling thread
+            auto encode_row = [&](uint32_t by, uint32_t) {
+                Block px;
+                uint8_t *row = out + (size_t)by * blocks_x * stride;
+                for (uint32_t bx = 0; bx < blocks_x; bx++) {
+                    fetch_block(rgba, width, height, bx, by, px);
+                    if (format == VK_FORMAT_BC1_RGB_SRGB_BLOCK)
+                        encode_bc1(px, row + bx * stride);
+                    else if (format == VK_FORMAT_BC3_SRGB_BLOCK)
+                        encode_bc3(px, row + bx * stride);
+                    else
+                        encode_bc7(px, row + bx * stride);
+                }
+            };
+            if (blocks_x * blocks_y < 256 || !encoders) {
+                for (uint32_t by = 0; by < blocks_y; by++)
+                    encode_row(by, 0);
+                return;
+            }
+            encoders->parallel_for(blocks_y, encode_row);
+        }
+
+        bool opaque(const uint8_t *rgba, size_t texels) {
+            for (size_t i = 0; i < texels; i++)
+                if (rgba[i * 4 + 3] != 255)
+                    return false;
+            return true;
+        }
+
+        void store(const std::string &path, const FileHeader &header, const uint8_t *data) {
+            // written next to the entry and renamed over it, a crash mid-write never leaves a torn entry behind
+            const std::string temp = path + "." + std::to_string(temporaryCount.fetch_add(1)) + ".tmp";
+            FILE *file = fopen(temp.c_str(), "wb");
+            if (!file) {
+                SDL_Log("[cook] Warning: could not write %s", temp.c_str());
+                return;
+            }
+            bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                      fwrite(data, 1, header.data_size, file) == header.data_size;
+            ok = fclose(file) == 0 && ok;
+            std::error_code error;
+            if (ok)
+                std::filesystem::rename(temp, path, error);
+            if (!ok || error) {
+                SDL_Log("[cook] Warning: could not save %s", path.c_str());
+                std::filesystem::remove(temp, error);
+            }
+        }
+
+        uint64_t rgba_bytes(uint32_t width, uint32_t height, uint32_t mipcount) {
+            uint64_t bytes = 0;
+            for (uint32_t level = 0; level < mipcount; level++)
+                bytes += (uint64_t)std::max(width >> level, 1u) * std::max(height >> level, 1u) * 4;
+            return bytes;
+        }
+    }
+
+    void init() {
+        build_tables();
+        encoders = std::make_unique<WorkerPool>(WorkerPool::default_thread_count());
+        directory.clear();
+        char *pref = SDL_GetPrefPath("Love", "LoveEngine");
+        if (!pref) {
+            SDL_Log("[cook] Warning: no pref path, cooked textures are not cached: %s", SDL_GetError());
+            return;
+        }
+        directory = std::string(pref) + "texture_cache/";
+        SDL_free(pref);
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) {
+            SDL_Log("[cook] Warning: could not create %s, cooked textures are not cached", directory.c_str());
+            directory.clear();
+        }
+    }
+    void shutdown() {
+        encoders.reset();
+    }
+    void set_quality(Quality quality) {
+        currentQuality = quality;
+    }
+
+    uint64_t content_hash(const uint8_t *data, size_t size) {
+        // 8 bytes per step through a multiply-xorshift mix, seeded with the size
+        uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            h = (h ^ word) * 0xff51afd7ed558ccdull;
+            h ^= h >> 32;
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, data + i, size - i);
+        h = (h ^ tail) * 0xc4ceb9fe1a85ec53ull;
+        return h ^ h >> 29;
+    }
+
+    bool load(uint64_t key, bool mips, CookedTexture &out) {
+        if (directory.empty())
+            return false;
+        const Quality quality = currentQuality;
+        const std::string path = entry_path(key, quality, mips);
+        FILE *file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        FileHeader header;
+        bool ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == file_magic &&
+                  header.version == file_version && header.key == key && header.quality == (uint8_t)quality &&
+                  header.mips == mips && header.mipcount >= 1 && header.mipcount <= MAX_IMAGE_MIPS &&
+                  header.data_size < (1ull << 32);
+        // the header alone decides how the blocks are uploaded, so it must describe exactly what cook() would write
+        const VkFormat format = (VkFormat)header.format;
+        ok = ok && cooked_format(format) && header.width >= 1 && header.height >= 1 &&
+             header.width <= (1u << (MAX_IMAGE_MIPS - 1)) && header.height <= (1u << (MAX_IMAGE_MIPS - 1)) &&
+             header.mipcount == chain_length(header.width, header.height, mips) &&
+             header.data_size == chain_bytes(format, header.width, header.height, header.mipcount);
+        uint8_t *data = nullptr;
+        if (ok) {
+            data = (uint8_t *)malloc(header.data_size);
+            ok = data && fread(data, 1, header.data_size, file) == header.data_size;
+        }
+        fclose(file);
+        if (!ok) {
+            free(data);
+            SDL_Log("[cook] Discarding invalid cache entry %s", path.c_str());
+            return false;
+        }
+        out = {format, header.width, header.height, header.mipcount, data, header.data_size};
+        hitCount.fetch_add(1, std::memory_order_relaxed);
+        sourceBytes.fetch_add(rgba_bytes(header.width, header.height, header.mipcount), std::memory_order_relaxed);
+        cookedBytes.fetch_add(header.data_size, std::memory_order_relaxed);
+        return true;
+    }
+
+    CookedTexture cook(uint64_t key, const uint8_t *rgba, uint32_t width, uint32_t height, bool mips) {
+        LOVE_ZONE("Cook texture");
+        const auto start = std::chrono::steady_clock::now();
+        const Quality quality = currentQuality;
+        const VkFormat format = opaque(rgba, (size_t)width * height) ? VK_FORMAT_BC1_RGB_SRGB_BLOCK
+                              : quality == Quality::Fast ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+        const uint32_t mipcount = chain_length(width, height, mips);
+        const size_t size = chain_bytes(format, width, height, mipcount);
+
+        CookedTexture result = {format, width, height, mipcount, (uint8_t *)malloc(size), size};
+        // two scratch levels ping-pong down the chain
+        std::unique_ptr<uint8_t[]> scratch[2];
+        const uint8_t *level_pixels = rgba;
+        uint8_t *out = result.data;
+        for (uint32_t level = 0; level < mipcount; level++) {
+            const uint32_t w = std::max(width >> level, 1u), h = std::max(height >> level, 1u);
+            if (level > 0) {
+                const uint32_t pw = std::max(width >> (level - 1), 1u), ph = std::max(height >> (level - 1), 1u);
+                std::unique_ptr<uint8_t[]> &next = scratch[level & 1];
+                if (!next)
+                    next = std::make_unique<uint8_t[]>((size_t)w * h * 4);
+                downsample(level_pixels, pw, ph, next.get());
+                level_pixels = next.get();
+            }
+            encode_level(level_pixels, w, h, format, out);
+            out += level_size(format, w, h);
+        }
+
+        cookedCount.fetch_add(1, std::memory_order_relaxed);
+        cookMicros.fetch_add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(),
+                             std::memory_order_relaxed);
+        sourceBytes.fetch_add(rgba_bytes(width, height, mipcount), std::memory_order_relaxed);
+        cookedBytes.fetch_add(size, std::memory_order_relaxed);
+
+        if (!directory.empty()) {
+            const FileHeader header = {
+                .magic = file_magic,
+                .version = file_version,
+                .key = key,
+                .format = (uint32_t)format,
+                .width = width,
+                .height = height,
+                .mipcount = mipcount,
+                .data_size = size,
+                .quality = (uint8_t)quality,
+                .mips = mips,
+            };
+            store(entry_path(key, quality, mips), header, result.data);
+        }
+        return result;
+    }
+
+    size_t level_size(VkFormat format, uint32_t width, uint32_t height) {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+    }
+
+    CookStats stats() {
+        return {
+            .cooked = cookedCount.load(std::memory_order_relaxed),
+            .cache_hits = hitCount.load(std::memory_order_relaxed),
+            .cook_ms = cookMicros.load(std::memory_order_relaxed) / 1000.0f,
+            .source_bytes = sourceBytes.load(std::memory_order_relaxed),
+            .cooked_bytes = cookedBytes.load(std::memory_order_relaxed),
+        };
+    }
+}
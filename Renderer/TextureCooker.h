@@ -0,0 +1,57 @@
+#ifndef TEXTURECOOKER_H
+#define TEXTURECOOKER_H
+#include <cstddef>
+#include <cstdint>
+#include <volk.h>
+
+/**
+ * Offline-style BCn cooking for streamed textures. Decoded RGBA8 sources get a CPU mip chain, filtered in linear
+ * space, and every level is encoded to BC1 when fully opaque, otherwise to BC7 (mode 6) or BC3 for the fast
+ * quality. Results go to an on-disk cache under the pref path keyed by a hash of the source file's bytes, so later
+ * launches only read the cooked blocks. Block rows are encoded on a worker pool of the cooker's own, so cook()
+ * can be called from other pools' workers. Everything but init(), shutdown() and set_quality() is thread safe.
+ */
+namespace renderer::cook {
+    enum class Quality : uint8_t {
+        Fast,   // BC3 for textures with alpha
+        Best,   // BC7 for textures with alpha
+    };
+
+    struct CookedTexture {
+        VkFormat format;
+        uint32_t width, height;
+        uint32_t mipcount;
+        uint8_t *data;      // every level's blocks back to back from level 0, release with free()
+        size_t size;
+    };
+
+    /// starts the encoder workers and finds or creates the cache directory, cooking still works without one
+    void init();
+    /// no cook() may be running
+    void shutdown();
+    /// applies to textures cooked from now on, cached results of the other quality are not reused
+    void set_quality(Quality quality);
+
+    /// 64 bit hash of a source file's bytes, the cache key
+    uint64_t content_hash(const uint8_t *data, size_t size);
+    /// @return false if nothing is cached for key or the entry is unreadable
+    bool load(uint64_t key, bool mips, CookedTexture &out);
+    /**
+     * encodes rgba and its mip chain, then stores the result under key
+     * @param rgba tightly packed RGBA8 rows in sRGB, width and height of any size
+     */
+    CookedTexture cook(uint64_t key, const uint8_t *rgba, uint32_t width, uint32_t height, bool mips);
+
+    /// bytes of one level, blocks are 4x4 texels with partial blocks at the edges padded
+    size_t level_size(VkFormat format, uint32_t width, uint32_t height);
+
+    struct CookStats {
+        uint32_t cooked;        // since startup
+        uint32_t cache_hits;
+        float cook_ms;          // total encoder time over every worker
+        uint64_t source_bytes;  // RGBA8 size of everything cooked or loaded, mips included
+        uint64_t cooked_bytes;  // what it takes as blocks
+    };
+    CookStats stats();
+}
+#endif //TEXTURECOOKER_H
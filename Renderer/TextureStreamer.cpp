@@ -0,0 +1,430 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <SDL3/SDL_log.h>
+#include <stb_image.h>
+
+#include "EngineImage.h"
+#include "GpuTimeline.h"
+#include "Renderer.h"
+#include "TextureCooker.h"
+#include "Ktx2.h"
+#include "renderer_constants.h"
+#include "../love_worker_pool.h"
+#include "../love_profiler.h"
+
+namespace renderer::streaming {
+    namespace {
+        constexpr uint32_t index_mask = (1u << TEXTURE_INDEX_BITS) - 1;
+        constexpr uint16_t generation_mask = (1u << (32 - TEXTURE_INDEX_BITS)) - 1;
+        // the last index stays unused so no handle equals INVALID_TEXTURE
+        constexpr uint32_t max_textures = index_mask;
+
+        // per slot metadata in separate arrays, the per frame scans only touch the ones they need
+        struct Textures {
+            std::vector<std::string> path;
+            std::vector<EngineImage *> image;
+            std::vector<uint64_t> bytes;        // device memory, 0 until the image exists
+            std::vector<uint64_t> staged;       // bytes handed to the staging ring
+            std::vector<uint64_t> releasedAt;   // stamp of the last release, the oldest unreferenced is evicted first
+            std::vector<uint32_t> refs;
+            std::vector<uint16_t> generation;
+            std::vector<TextureState> state;
+            std::vector<uint8_t> mips;
+            std::vector<uint8_t> live;
+
+            uint32_t size() const { return (uint32_t)path.size(); }
+            void grow() {
+                path.emplace_back();
+                image.push_back(nullptr);
+                bytes.push_back(0);
+                staged.push_back(0);
+                releasedAt.push_back(0);
+                refs.push_back(0);
+                generation.push_back(0);
+                state.push_back(TextureState::Queued);
+                mips.push_back(0);
+                live.push_back(0);
+            }
+            void clear() {
+                path.clear();
+                image.clear();
+                bytes.clear();
+                staged.clear();
+                releasedAt.clear();
+                refs.clear();
+                generation.clear();
+                state.clear();
+                mips.clear();
+                live.clear();
+            }
+        };
+        struct Decoded {
+            TextureHandle handle;
+            uint8_t *pixels;    // RGBA8, or what prebuilt's levels point into, nullptr if the decode failed
+            void (*release)(void *);
+            PrebuiltImage prebuilt; // format VK_FORMAT_UNDEFINED and only the size set for RGBA8 pixels
+            uint64_t size;
+        };
+
+        // main thread only
+        Textures textures;
+        std::unordered_map<std::string, TextureHandle> byPath;
+        std::vector<uint32_t> freeSlots;
+        std::vector<uint32_t> uploading;
+        EngineImage *placeholder = nullptr;
+        uint64_t residentBytes = 0;
+        uint64_t cacheBudget = STREAMING_CACHE_BUDGET;
+        uint64_t releaseStamp = 0;
+        uint64_t hitCount = 0, evictedCount = 0;
+
+        // shared with the decode workers
+        std::unique_ptr<WorkerPool> workers;
+        std::mutex decodedMutex;
+        std::deque<Decoded> decoded;
+        std::atomic<uint32_t> queuedCount = 0;
+        std::atomic<uint64_t> windowDecoded = 0;
+        std::atomic<bool> cancelled = false;
+
+        std::chrono::steady_clock::time_point windowStart;
+        uint64_t windowUploaded = 0;
+        float decodeRate = 0, uploadRate = 0;
+
+        // 2x2 magenta/black checker shown until a texture is ready
+        uint8_t placeholderPixels[16] = {
+            255, 0, 255, 255,   0, 0, 0, 255,
+            0, 0, 0, 255,       255, 0, 255, 255,
+        };
+
+        TextureHandle make_handle(uint32_t slot) {
+            return slot | (uint32_t)textures.generation[slot] << TEXTURE_INDEX_BITS;
+        }
+
+        /// UINT32_MAX for handles whose texture was freed or never existed
+        uint32_t slot_of(TextureHandle handle) {
+            const uint32_t slot = handle & index_mask;
+            if (slot >= textures.size() || !textures.live[slot] ||
+                textures.generation[slot] != handle >> TEXTURE_INDEX_BITS)
+                return UINT32_MAX;
+            return slot;
+        }
+
+        void free_slot(uint32_t slot) {
+            if (EngineImage *image = textures.image[slot]) {
+                image->destroy();
+                delete image;
+            }
+            auto found = byPath.find(textures.path[slot]);
+            if (found != byPath.end() && found->second == make_handle(slot))
+                byPath.erase(found);
+            residentBytes -= textures.bytes[slot];
+            textures.path[slot].clear();
+            textures.image[slot] = nullptr;
+            textures.bytes[slot] = 0;
+            textures.staged[slot] = 0;
+            textures.refs[slot] = 0;
+            textures.state[slot] = TextureState::Queued;
+            textures.live[slot] = 0;
+            textures.generation[slot] = (textures.generation[slot] + 1) & generation_mask;
+            freeSlots.push_back(slot);
+        }
+
+        // unreferenced ready textures go oldest release first until the budget holds or none are left
+        void evict() {
+            while (residentBytes > cacheBudget) {
+                uint32_t oldest = UINT32_MAX;
+                for (uint32_t slot = 0; slot < textures.size(); slot++)
+                    if (textures.live[slot] && textures.refs[slot] == 0 && textures.state[slot] == TextureState::Ready &&
+                        (oldest == UINT32_MAX || textures.releasedAt[slot] < textures.releasedAt[oldest]))
+                        oldest = slot;
+                if (oldest == UINT32_MAX)
+                    return;
+                free_slot(oldest);
+                evictedCount++;
+            }
+        }
+
+        /// nullptr if the file can't be read, release with free()
+        uint8_t *read_file(const std::string &path, size_t &size) {
+            FILE *file = fopen(path.c_str(), "rb");
+            if (!file)
+                return nullptr;
+            uint8_t *data = nullptr;
+            bool ok = fseek(file, 0, SEEK_END) == 0;
+            const long length = ok ? ftell(file) : -1;
+            ok = length >= 0 && fseek(file, 0, SEEK_SET) == 0;
+            if (ok) {
+                size = (size_t)length;
+                data = (uint8_t *)malloc(size ? size : 1);
+                ok = data && fread(data, 1, size, file) == size;
+            }
+            fclose(file);
+            if (!ok) {
+                free(data);
+                return nullptr;
+            }
+            return data;
+        }
+
+        PrebuiltImage prebuilt_from(const cook::CookedTexture &cooked) {
+            PrebuiltImage prebuilt = {
+                .format = cooked.format,
+                .width = cooked.width,
+                .height = cooked.height,
+                .mipcount = cooked.mipcount,
+                .block_extent = 4,
+                .block_size = cooked.format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK ? 8u : 16u,
+            };
+            const uint8_t *level = cooked.data;
+            for (uint32_t mip = 0; mip < cooked.mipcount; mip++) {
+                prebuilt.levels[mip] = level;
+                level += cook::level_size(cooked.format, std::max(cooked.width >> mip, 1u), std::max(cooked.height >> mip, 1u));
+            }
+            return prebuilt;
+        }
+
+        /**
+         * reads the file once. KTX2 files are uploaded from those bytes as they are. Otherwise, with BC support,
+         * the bytes are hashed and the cooked blocks come from the cache or get cooked from the decoded pixels,
+         * without it the pixels are uploaded as they are
+         */
+        void decode(TextureHandle handle, const std::string &path, bool mips) {
+            LOVE_ZONE("Decode texture");
+            Decoded result = {handle, nullptr, nullptr, {}, 0};
+            size_t size = 0;
+            uint8_t *file = nullptr;
+            if (cancelled.load(std::memory_order_relaxed)) {
+                // dropped below
+            } else if (!(file = read_file(path, size))) {
+                SDL_Log("[streaming] could not read %s", path.c_str());
+            } else if (ktx2::is_ktx2(file, size)) {
+                PrebuiltImage prebuilt;
+                if (!ktx2::parse(file, size, path.c_str(), prebuilt)) {
+                    free(file);
+                } else if (prebuilt.layers > 1) {
+                    // streamed textures live in the bindless table, which only holds 2D views
+                    SDL_Log("[streaming] %s is a texture array, load it with EngineImage::make", path.c_str());
+                    free(file);
+                } else {
+                    result = {handle, file, free, prebuilt, size};
+                }
+                file = nullptr;
+            } else {
+                const uint64_t key = g_TextureCompressionBC ? cook::content_hash(file, size) : 0;
+                cook::CookedTexture cooked;
+                if (g_TextureCompressionBC && cook::load(key, mips, cooked)) {
+                    result = {handle, cooked.data, free, prebuilt_from(cooked), cooked.size};
+                } else {
+                    int width, height, channels;
+                    // forcing 4 components keeps every streamed texture RGBA8, which the blit mip path supports everywhere
+                    uint8_t *pixels = stbi_load_from_memory(file, (int)size, &width, &height, &channels, 4);
+                    if (!pixels) {
+                        SDL_Log("[streaming] could not decode %s: %s", path.c_str(), stbi_failure_reason());
+                    } else if (g_TextureCompressionBC) {
+                        cooked = cook::cook(key, pixels, width, height, mips);
+                        stbi_image_free(pixels);
+                        result = {handle, cooked.data, free, prebuilt_from(cooked), cooked.size};
+                    } else {
+                        result = {handle, pixels, stbi_image_free,
+                                  {.width = (uint32_t)width, .height = (uint32_t)height},
+                                  (uint64_t)width * height * 4};
+                    }
+                }
+            }
+            free(file);
+            windowDecoded.fetch_add(result.size, std::memory_order_relaxed);
+            {
+                std::lock_guard lock(decodedMutex);
+                decoded.push_back(result);
+            }
+            queuedCount.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        // loads in flight keep their slot even without references, so the handle is always valid here
+        void create_image(const Decoded &result) {
+            const uint32_t slot = result.handle & index_mask;
+            if (!result.pixels) {
+                textures.state[slot] = TextureState::Failed;
+                // a later request retries the file instead of getting this failure back
+                byPath.erase(textures.path[slot]);
+                if (textures.refs[slot] == 0)
+                    free_slot(slot);
+                return;
+            }
+            EngineImage *image = result.prebuilt.format == VK_FORMAT_UNDEFINED
+                ? EngineImage::make_from_pixels(result.pixels, result.prebuilt.width, result.prebuilt.height, 4,
+                                                VK_IMAGE_USAGE_SAMPLED_BIT, textures.mips[slot], result.release)
+                : EngineImage::make_prebuilt(result.prebuilt, VK_IMAGE_USAGE_SAMPLED_BIT, result.pixels, result.release);
+            textures.image[slot] = image;
+            textures.staged[slot] = result.size;
+            textures.bytes[slot] = image->alloc_info.size;
+            residentBytes += image->alloc_info.size;
+            textures.state[slot] = TextureState::Uploading;
+            uploading.push_back(slot);
+        }
+    }
+
+    void init(uint32_t threads) {
+        cancelled = false;
+        workers = std::make_unique<WorkerPool>(threads ? threads : WorkerPool::default_thread_count(4));
+        placeholder = EngineImage::make_from_pixels(placeholderPixels, 2, 2, 4, VK_IMAGE_USAGE_SAMPLED_BIT, false, nullptr);
+        windowStart = std::chrono::steady_clock::now();
+    }
+    void shutdown() {
+        cancelled = true;
+        workers.reset();
+        for (auto &result : decoded)
+            if (result.pixels) result.release(result.pixels);
+        decoded.clear();
+        for (uint32_t slot = 0; slot < textures.size(); slot++)
+            if (textures.live[slot])
+                free_slot(slot);
+        textures.clear();
+        byPath.clear();
+        freeSlots.clear();
+        uploading.clear();
+        residentBytes = 0;
+        placeholder->destroy();
+        delete placeholder;
+        placeholder = nullptr;
+    }
+
+    void pump() {
+        // hand decoded textures to the staging ring until this frame's budget is spent, always at least one
+        std::vector<Decoded> batch;
+        {
+            std::lock_guard lock(decodedMutex);
+            uint64_t budget = 0;
+            while (!decoded.empty() && (batch.empty() || budget < STREAMING_UPLOAD_BUDGET)) {
+                budget += decoded.front().size;
+                batch.push_back(decoded.front());
+                decoded.pop_front();
+            }
+        }
+        for (const auto &result : batch)
+            create_image(result);
+
+        for (size_t i = 0; i < uploading.size();) {
+            const uint32_t slot = uploading[i];
+            const EngineImage *image = textures.image[slot];
+            // the staging ring holds a pointer to the image until the last chunk is recorded
+            if (!image->uploaded || !timeline::is_complete(image->upload_value)) {
+                i++;
+                continue;
+            }
+            textures.state[slot] = TextureState::Ready;
+            windowUploaded += textures.staged[slot];
+            uploading[i] = uploading.back();
+            uploading.pop_back();
+        }
+        evict();
+
+        const auto now = std::chrono::steady_clock::now();
+        const float elapsed = std::chrono::duration<float>(now - windowStart).count();
+        if (elapsed >= 1.0f) {
+            decodeRate = windowDecoded.exchange(0, std::memory_order_relaxed) / elapsed / (1024.0f * 1024.0f);
+            uploadRate = windowUploaded / elapsed / (1024.0f * 1024.0f);
+            windowUploaded = 0;
+            windowStart = now;
+        }
+    }
+
+    TextureHandle request(ResourceLocator source, bool generate_mips) {
+        auto found = byPath.find(source.path);
+        if (found != byPath.end()) {
+            textures.refs[found->second & index_mask]++;
+            hitCount++;
+            return found->second;
+        }
+
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else if (textures.size() < max_textures) {
+            slot = textures.size();
+            textures.grow();
+        } else {
+            SDL_Log("[streaming] Error: all %u texture slots are taken, %s is not loaded", max_textures, source.path);
+            return INVALID_TEXTURE;
+        }
+        textures.path[slot] = source.path;
+        textures.mips[slot] = generate_mips;
+        textures.refs[slot] = 1;
+        textures.state[slot] = TextureState::Queued;
+        textures.live[slot] = 1;
+        const TextureHandle handle = make_handle(slot);
+        byPath.emplace(textures.path[slot], handle);
+
+        queuedCount.fetch_add(1, std::memory_order_relaxed);
+        workers->submit([handle, path = textures.path[slot], generate_mips](uint32_t) { decode(handle, path, generate_mips); });
+        return handle;
+    }
+    void add_ref(TextureHandle handle) {
+        const uint32_t slot = slot_of(handle);
+        if (slot != UINT32_MAX)
+            textures.refs[slot]++;
+    }
+    void release(TextureHandle handle) {
+        const uint32_t slot = slot_of(handle);
+        if (slot == UINT32_MAX || textures.refs[slot] == 0)
+            return;
+        if (--textures.refs[slot] > 0)
+            return;
+        textures.releasedAt[slot] = ++releaseStamp;
+        if (textures.state[slot] == TextureState::Failed)
+            free_slot(slot);
+    }
+    void set_budget(uint64_t bytes) {
+        cacheBudget = bytes;
+    }
+
+    TextureState state(TextureHandle handle) {
+        const uint32_t slot = slot_of(handle);
+        return slot == UINT32_MAX ? TextureState::Failed : textures.state[slot];
+    }
+    EngineImage *image(TextureHandle handle) {
+        const uint32_t slot = slot_of(handle);
+        return slot != UINT32_MAX && textures.state[slot] == TextureState::Ready ? textures.image[slot] : nullptr;
+    }
+    VkImageView view(TextureHandle handle) {
+        EngineImage *ready = image(handle);
+        return ready ? ready->imageView : placeholder->imageView;
+    }
+    VkImageView placeholder_view() {
+        return placeholder->imageView;
+    }
+
+    StreamingStats stats() {
+        StreamingStats result = {
+            .queued = queuedCount.load(std::memory_order_relaxed),
+            .uploading = (uint32_t)uploading.size(),
+            .resident_bytes = residentBytes,
+            .budget_bytes = cacheBudget,
+            .hits = hitCount,
+            .evicted = evictedCount,
+            .decode_mb_s = decodeRate,
+            .upload_mb_s = uploadRate,
+        };
+        {
+            std::lock_guard lock(decodedMutex);
+            result.decoded = (uint32_t)decoded.size();
+        }
+        for (uint32_t slot = 0; slot < textures.size(); slot++)
+            if (textures.live[slot] && textures.state[slot] == TextureState::Ready) {
+                result.ready++;
+                if (textures.refs[slot] == 0)
+                    result.cached++;
+            }
+        return result;
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef TEXTURESTREAMER_H
+#define TEXTURESTREAMER_H
+#include <cstdint>
+#include <volk.h>
+
+#include "../love_resource_locator.h"
+
+class EngineImage;
+
+/**
+ * Asynchronous texture loading and the registry that owns every texture loaded from a file. Files are decoded
+ * on a background worker pool, the decoded pixels are handed to the staging ring at most STREAMING_UPLOAD_BUDGET
+ * bytes per frame so every upload goes out with the frame's single upload submit, and a texture becomes ready
+ * once the timeline passes that submit. Until then view() returns a placeholder so callers can draw right away.
+ * When the device samples BCn, workers hand renderer::cook the file instead and upload its cooked mip chain.
+ *
+ * Textures are reference counted and deduplicated by path, requesting a file that is already loaded or loading
+ * is a hash lookup. Released textures stay cached until the streamed textures exceed the memory budget, then
+ * the least recently released are evicted. Handles carry a generation, a handle to an evicted texture stays
+ * invalid even after its slot is reused.
+ */
+namespace renderer::streaming {
+    /// slot index in the low TEXTURE_INDEX_BITS, the slot's generation above
+    using TextureHandle = uint32_t;
+    constexpr TextureHandle INVALID_TEXTURE = UINT32_MAX;
+    constexpr uint32_t TEXTURE_INDEX_BITS = 20;
+
+    enum class TextureState {
+        Queued,    // waiting for or being decoded by a worker
+        Uploading, // image created, staging copy not finished on the GPU yet
+        Ready,
+        Failed,
+    };
+
+    /// starts the decode workers, threads = 0 picks WorkerPool::default_thread_count(4)
+    void init(uint32_t threads = 0);
+    /// call after the device is idle and before shutdown_frame_resource_manager()
+    void shutdown();
+    /// creates images for finished decodes and promotes completed uploads, once per frame after advance
+    void pump();
+
+    /**
+     * returns immediately with a reference the caller has to release, the file is read and decoded on a worker
+     * unless the registry already has it
+     * @param generate_mips only used by the request that loads the file
+     */
+    TextureHandle request(ResourceLocator source, bool generate_mips = true);
+    /// another reference to a valid handle
+    void add_ref(TextureHandle handle);
+    /// drops a reference, the last one leaves the texture cached and evictable, failed loads are freed right away
+    void release(TextureHandle handle);
+    /// device memory streamed textures may take before unreferenced ones are evicted, applied on the next pump
+    void set_budget(uint64_t bytes);
+
+    TextureState state(TextureHandle handle);
+    /// nullptr until the texture is Ready, owned by the registry
+    EngineImage *image(TextureHandle handle);
+    /// the texture's view when Ready, the placeholder view otherwise, always SHADER_READ_ONLY_OPTIMAL
+    VkImageView view(TextureHandle handle);
+    VkImageView placeholder_view();
+
+    struct StreamingStats {
+        uint32_t queued;    // requests not decoded yet
+        uint32_t decoded;   // decoded and waiting for upload budget
+        uint32_t uploading;
+        uint32_t ready;
+        uint32_t cached;        // ready with no references left, evicted first when over budget
+        uint64_t resident_bytes; // device memory of every streamed texture
+        uint64_t budget_bytes;
+        uint64_t hits;          // requests served by an already known texture, since startup
+        uint64_t evicted;       // since startup
+        float decode_mb_s;  // decoded or cooked bytes per second, averaged over the last second
+        float upload_mb_s;  // bytes that finished uploading per second, same window
+    };
+    StreamingStats stats();
+}
+#endif //TEXTURESTREAMER_H
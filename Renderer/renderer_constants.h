@@ -4,5 +4,28 @@
 
 #ifndef RENDERER_CONSTANTS_H
 #define RENDERER_CONSTANTS_H
+// per-frame resource slots, the upper bound for pacing::frames_in_flight()
 #define MAX_INFLIGHT_FRAMES 3
+// bytes of persistently mapped upload memory per in-flight frame
+#define STAGING_RING_SIZE (32ull*1024*1024)
+// bytes of dynamic uniform/vertex/index data per in-flight frame
+#define FRAME_ALLOCATOR_SIZE (16ull*1024*1024)
+// decoded texture bytes the streamer hands to the staging ring per frame
+#define STREAMING_UPLOAD_BUDGET (16ull*1024*1024)
+// default device memory for streamed textures, past it unreferenced ones are evicted oldest first
+#define STREAMING_CACHE_BUDGET (256ull*1024*1024)
+// ImGui texture descriptor sets, one per thumbnail the editor shows
+#define IMGUI_TEXTURE_POOL_SIZE 1024
+// seconds between pipeline cache saves while running
+#define PIPELINE_CACHE_SAVE_INTERVAL 60
+// timestamp zones the GPU profiler can record per frame
+#define MAX_GPU_PROFILER_ZONES 32
+// textures the sprite batcher can have registered at once, keys hold the slot in 16 bits
+#define MAX_SPRITE_TEXTURES 4096
+// sprites per parallel recording job, smaller frames use fewer jobs than there are recording threads
+#define SPRITES_PER_RECORD_JOB 16384
+// slots in the bindless texture array, clamped to the device's update-after-bind limits
+#define BINDLESS_TEXTURE_CAPACITY 16384
+// mip levels EngineImage tracks barrier state for, a full chain of a 32768 texel image
+#define MAX_IMAGE_MIPS 16
 #endif //RENDERER_CONSTANTS_H
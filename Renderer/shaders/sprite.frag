@@ -0,0 +1,14 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+// renderer::bindless texture table
+layout(set = 0, binding = 0) uniform texture2D textures[];
+layout(set = 0, binding = 1) uniform sampler linear_sampler;
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 1) in vec4 in_color;
+layout(location = 2) flat in uint in_texture;
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    out_color = texture(sampler2D(textures[nonuniformEXT(in_texture)], linear_sampler), in_uv) * in_color;
+}
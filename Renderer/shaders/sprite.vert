@@ -0,0 +1,26 @@
+#version 450
+// One instanced quad per sprite, the corner comes from gl_VertexIndex of a 4 vertex triangle strip.
+// basis holds the sprite's x and y axes already scaled by its size and rotated, so no trig runs per vertex.
+layout(location = 0) in vec4 in_basis;
+layout(location = 1) in vec2 in_center;
+layout(location = 2) in vec4 in_uv;     // u0 v0 u1 v1
+layout(location = 3) in vec4 in_color;
+layout(location = 4) in uint in_texture;
+
+layout(push_constant) uniform Push {
+    vec2 scale;     // world to clip
+    vec2 offset;
+} pc;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec4 out_color;
+layout(location = 2) flat out uint out_texture;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 world = in_center + in_basis.xy * (corner.x - 0.5) + in_basis.zw * (corner.y - 0.5);
+    gl_Position = vec4(world * pc.scale + pc.offset, 0.0, 1.0);
+    out_uv = mix(in_uv.xy, in_uv.zw, corner);
+    out_color = in_color;
+    out_texture = in_texture;
+}
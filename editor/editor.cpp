@@ -1,5 +1,12 @@
 #include "editor.hpp"
 
+#include "../Renderer/ResourceManager.h"
+#include "../Renderer/Barriers.h"
+#include "../Renderer/RenderGraph.h"
+#include "../Renderer/EngineImage.h"
+#include "../Renderer/TextureCooker.h"
+#include "../love_profiler.h"
+
 namespace fs = std::filesystem;
 
 
@@ -12,250 +19,49 @@ static void check_vk_result(VkResult err)
         panic();
 }
 
-// Helper function to find Vulkan memory type bits. See ImGui_ImplVulkan_MemoryType() in imgui_impl_vulkan.cpp
-uint32_t findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties)
-{
-    VkPhysicalDeviceMemoryProperties mem_properties;
-    vkGetPhysicalDeviceMemoryProperties(renderer::g_PhysicalDevice, &mem_properties);
-
-    for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++)
-        if ((type_filter & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties)
-            return i;
-
-    return 0xFFFFFFFF; // Unable to find memoryType
-}
-
-// Helper function to load an image with common settings and return a MyTextureData with a VkDescriptorSet as a sort of Vulkan pointer
-bool LoadTextureFromFile(const char* filename, MyTextureData* tex_data)
-{
-    // Specifying 4 channels forces stb to load the image in RGBA which is an easy format for Vulkan
-    tex_data->Channels = 4;
-    unsigned char* image_data = stbi_load(filename, &tex_data->Width, &tex_data->Height, 0, tex_data->Channels);
-
-    if (image_data == NULL)
-        return false;
-
-    // Calculate allocation size (in number of bytes)
-    size_t image_size = tex_data->Width * tex_data->Height * tex_data->Channels;
-
-    VkResult err;
-
-    // Create the Vulkan image.
-    {
-        VkImageCreateInfo info = {};
-        info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-        info.imageType = VK_IMAGE_TYPE_2D;
-        info.format = VK_FORMAT_R8G8B8A8_UNORM;
-        info.extent.width = tex_data->Width;
-        info.extent.height = tex_data->Height;
-        info.extent.depth = 1;
-        info.mipLevels = 1;
-        info.arrayLayers = 1;
-        info.samples = VK_SAMPLE_COUNT_1_BIT;
-        info.tiling = VK_IMAGE_TILING_OPTIMAL;
-        info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        err = vkCreateImage(renderer::device, &info, renderer::g_vk_Allocator, &tex_data->Image);
-        check_vk_result(err);
-        VkMemoryRequirements req;
-        vkGetImageMemoryRequirements(renderer::device, tex_data->Image, &req);
-        VkMemoryAllocateInfo alloc_info = {};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = req.size;
-        alloc_info.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        err = vkAllocateMemory(renderer::device, &alloc_info, renderer::g_vk_Allocator, &tex_data->ImageMemory);
-        check_vk_result(err);
-        err = vkBindImageMemory(renderer::device, tex_data->Image, tex_data->ImageMemory, 0);
-        check_vk_result(err);
-    }
-
-    // Create the Image View
-    {
-        VkImageViewCreateInfo info = {};
-        info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-        info.image = tex_data->Image;
-        info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        info.format = VK_FORMAT_R8G8B8A8_UNORM;
-        info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        info.subresourceRange.levelCount = 1;
-        info.subresourceRange.layerCount = 1;
-        err = vkCreateImageView(renderer::device, &info, renderer::g_vk_Allocator, &tex_data->ImageView);
-        check_vk_result(err);
-    }
-
-    // Create Sampler
-    {
-        VkSamplerCreateInfo sampler_info{};
-        sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-        sampler_info.magFilter = VK_FILTER_LINEAR;
-        sampler_info.minFilter = VK_FILTER_LINEAR;
-        sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-        sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT; // outside image bounds just use border color
-        sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-        sampler_info.minLod = -1000;
-        sampler_info.maxLod = 1000;
-        sampler_info.maxAnisotropy = 1.0f;
-        err = vkCreateSampler(renderer::device, &sampler_info, renderer::g_vk_Allocator, &tex_data->Sampler);
-        check_vk_result(err);
-    }
-
-    // Create Descriptor Set using ImGUI's implementation
-    tex_data->DS = ImGui_ImplVulkan_AddTexture(tex_data->Sampler, tex_data->ImageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-    // Create Upload Buffer
-    {
-        VkBufferCreateInfo buffer_info = {};
-        buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        buffer_info.size = image_size;
-        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        err = vkCreateBuffer(renderer::device, &buffer_info, renderer::g_vk_Allocator, &tex_data->UploadBuffer);
-        check_vk_result(err);
-        VkMemoryRequirements req;
-        vkGetBufferMemoryRequirements(renderer::device, tex_data->UploadBuffer, &req);
-        VkMemoryAllocateInfo alloc_info = {};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = req.size;
-        alloc_info.memoryTypeIndex = findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
-        err = vkAllocateMemory(renderer::device, &alloc_info, renderer::g_vk_Allocator, &tex_data->UploadBufferMemory);
-        check_vk_result(err);
-        err = vkBindBufferMemory(renderer::device, tex_data->UploadBuffer, tex_data->UploadBufferMemory, 0);
-        check_vk_result(err);
-    }
-
-    // Upload to Buffer:
-    {
-        void* map = NULL;
-        err = vkMapMemory(renderer::device, tex_data->UploadBufferMemory, 0, image_size, 0, &map);
-        check_vk_result(err);
-        memcpy(map, image_data, image_size);
-        VkMappedMemoryRange range[1] = {};
-        range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        range[0].memory = tex_data->UploadBufferMemory;
-        range[0].size = image_size;
-        err = vkFlushMappedMemoryRanges(renderer::device, 1, range);
-        check_vk_result(err);
-        vkUnmapMemory(renderer::device, tex_data->UploadBufferMemory);
-    }
-
-    // Release image memory using stb
-    stbi_image_free(image_data);
-
-    // Create a command buffer that will perform following steps when hit in the command queue.
-    // TODO: this works in the example, but may need input if this is an acceptable way to access the pool/create the command buffer.
-    VkCommandPool command_pool = renderer::imgui::imgui_MainWindowData.Frames[ renderer::imgui::imgui_MainWindowData.FrameIndex].CommandPool;
-    VkCommandBuffer command_buffer;
-    {
-        VkCommandBufferAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandPool = command_pool;
-        alloc_info.commandBufferCount = 1;
-
-        err = vkAllocateCommandBuffers(renderer::device, &alloc_info, &command_buffer);
-        check_vk_result(err);
-
-        VkCommandBufferBeginInfo begin_info = {};
-        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        err = vkBeginCommandBuffer(command_buffer, &begin_info);
-        check_vk_result(err);
-    }
-
-    // Copy to Image
-    {
-        VkImageMemoryBarrier copy_barrier[1] = {};
-        copy_barrier[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        copy_barrier[0].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        copy_barrier[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        copy_barrier[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        copy_barrier[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        copy_barrier[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        copy_barrier[0].image = tex_data->Image;
-        copy_barrier[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        copy_barrier[0].subresourceRange.levelCount = 1;
-        copy_barrier[0].subresourceRange.layerCount = 1;
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, copy_barrier);
-
-        VkBufferImageCopy region = {};
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.layerCount = 1;
-        region.imageExtent.width = tex_data->Width;
-        region.imageExtent.height = tex_data->Height;
-        region.imageExtent.depth = 1;
-        vkCmdCopyBufferToImage(command_buffer, tex_data->UploadBuffer, tex_data->Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        VkImageMemoryBarrier use_barrier[1] = {};
-        use_barrier[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        use_barrier[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        use_barrier[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        use_barrier[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        use_barrier[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        use_barrier[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        use_barrier[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        use_barrier[0].image = tex_data->Image;
-        use_barrier[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        use_barrier[0].subresourceRange.levelCount = 1;
-        use_barrier[0].subresourceRange.layerCount = 1;
-        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, use_barrier);
-    }
-
-    // End command buffer
-    {
-        VkSubmitInfo end_info = {};
-        end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        end_info.commandBufferCount = 1;
-        end_info.pCommandBuffers = &command_buffer;
-        err = vkEndCommandBuffer(command_buffer);
-        check_vk_result(err);
-        err = vkQueueSubmit(renderer::g_Queue, 1, &end_info, VK_NULL_HANDLE);
-        check_vk_result(err);
-        err = vkDeviceWaitIdle(renderer::device);
-        check_vk_result(err);
-    }
-
-    return true;
-}
-
-// Helper function to cleanup an image loaded with LoadTextureFromFile
-void RemoveTexture(MyTextureData* tex_data)
-{
-    vkFreeMemory(renderer::device, tex_data->UploadBufferMemory, nullptr);
-    vkDestroyBuffer(renderer::device, tex_data->UploadBuffer, nullptr);
-    vkDestroySampler(renderer::device, tex_data->Sampler, nullptr);
-    vkDestroyImageView(renderer::device, tex_data->ImageView, nullptr);
-    vkDestroyImage(renderer::device, tex_data->Image, nullptr);
-    vkFreeMemory(renderer::device, tex_data->ImageMemory, nullptr);
-    ImGui_ImplVulkan_RemoveTexture(tex_data->DS);
-}
-
-
 love::Editor::Editor(SDL_Window* window) {
     SetupImGuiStyle(editor::Theme::Default);
     ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
     ImGuiIO& io = ImGui::GetIO();
-    int display_w, display_h, w, h;
-    SDL_GetWindowSize(window, &display_w, &display_h);
-
-    SDL_GetWindowSizeInPixels(window, &w, &h);
-    io.DisplayFramebufferScale = ImVec2(0.5f, 0.5f);
-    io.DisplaySize = ImVec2((float)display_w, (float)display_h);
+    int display_w = 0, display_h = 0, w, h;
+    // headless runs have no window, main sets the display size every frame
+    if (window) {
+        SDL_GetWindowSize(window, &display_w, &display_h);
+
+        SDL_GetWindowSizeInPixels(window, &w, &h);
+        io.DisplayFramebufferScale = ImVec2(0.5f, 0.5f);
+        io.DisplaySize = ImVec2((float)display_w, (float)display_h);
+    }
 
     c_assetSearchBuffer = (char*)malloc(sizeof(char) * 1024);
     c_consoleInputBuffer = (char*)malloc(sizeof(char) * t_consoleInputBufferSize);
     // memset(c_consoleInputBuffer, 0, t_consoleInputBufferSize * sizeof(char));
 
-    renderer = SDL_CreateRenderer(window, NULL);
-    if (!renderer) {
+    renderer = window ? SDL_CreateRenderer(window, NULL) : nullptr;
+    if (window && !renderer) {
         SDL_Log("Error creating SDL_Renderer for editor: %s", SDL_GetError());
     }
 
+    VkSamplerCreateInfo sampler_info{};
+    sampler_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    sampler_info.magFilter = VK_FILTER_LINEAR;
+    sampler_info.minFilter = VK_FILTER_LINEAR;
+    sampler_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler_info.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    sampler_info.minLod = -1000;
+    sampler_info.maxLod = 1000;
+    sampler_info.maxAnisotropy = 1.0f;
+    check_vk_result(vkCreateSampler(renderer::device, &sampler_info, renderer::g_vk_Allocator, &assetSampler));
+    placeholderDS = ImGui_ImplVulkan_AddTexture(assetSampler, renderer::streaming::placeholder_view(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 }
 
 love::Editor::~Editor() {
-
+    for (size_t i = assetsImage.size(); i-- > 0;)
+        removeImageAsset(i);
+    ImGui_ImplVulkan_RemoveTexture(placeholderDS);
+    defer_destroy_sampler(assetSampler);
 }
 
 void love::Editor::check_events(const SDL_Event* event) {
@@ -314,6 +120,9 @@ void love::Editor::draw(bool& done) {
             ImGui::Checkbox("Explorer", &b_explorerShow);
             ImGui::Checkbox("Console", &b_consoleShow);
             ImGui::Checkbox("Asset Browser", &b_assetBrowserShow);
+            ImGui::Checkbox("GPU Profiler", &b_gpuProfilerShow);
+            ImGui::Checkbox("CPU Profiler", &b_cpuProfilerShow);
+            ImGui::Checkbox("Frame Pacing", &b_framePacingShow);
 
             ImGui::EndMenu();
         }
@@ -331,11 +140,71 @@ void love::Editor::draw(bool& done) {
     if (b_consoleShow) {
         showConsole(&b_consoleShow);
     }
+    if (b_gpuProfilerShow) {
+        showGpuProfiler(&b_gpuProfilerShow);
+    }
+    if (b_cpuProfilerShow) {
+        showCpuProfiler(&b_cpuProfilerShow);
+    }
+    if (b_framePacingShow) {
+        showFramePacing(&b_framePacingShow);
+    }
 
     b_eventFileDropped = false;
     c_eventFileDroppedName = nullptr;
 }
 
+void love::Editor::queueImageAsset(const fs::path& path) {
+    std::string extension = path.extension();
+    if (extension != ".jpg" && extension != ".png" && extension != ".jpeg" && extension != ".bmp" && extension != ".tga" && extension != ".ktx2") {
+        SDL_Log("Skipping %s, not an image", path.c_str());
+        return;
+    }
+    love::editor::ImageAsset imageAsset;
+    imageAsset.path = path.string();
+    imageAsset.name = path.filename();
+    imageAsset.texture = renderer::streaming::request({imageAsset.path.c_str()});
+    imageAsset.data.DS = placeholderDS;
+    assetsImage.push_back(imageAsset);
+}
+
+void love::Editor::updateImageAssets() {
+    for (auto& asset : assetsImage) {
+        if (asset.ready || asset.texture == renderer::streaming::INVALID_TEXTURE)
+            continue;
+        switch (renderer::streaming::state(asset.texture)) {
+            case renderer::streaming::TextureState::Ready: {
+                EngineImage* image = renderer::streaming::image(asset.texture);
+                asset.data.Width = (int)image->width;
+                asset.data.Height = (int)image->height;
+                asset.data.Channels = 4;
+                asset.data.GpuBytes = image->alloc_info.size;
+                asset.data.DS = ImGui_ImplVulkan_AddTexture(assetSampler, image->imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                asset.ready = true;
+                break;
+            }
+            case renderer::streaming::TextureState::Failed:
+                log(editor::LogType::Error, "Could not load image " + asset.path);
+                renderer::streaming::release(asset.texture);
+                asset.texture = renderer::streaming::INVALID_TEXTURE;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void love::Editor::removeImageAsset(size_t index) {
+    love::editor::ImageAsset& asset = assetsImage[index];
+    // this frame's draw list may still reference the descriptor set, it goes once the frame retires
+    if (asset.ready) {
+        VkDescriptorSet ds = asset.data.DS;
+        deferffl([ds] { ImGui_ImplVulkan_RemoveTexture(ds); });
+    }
+    renderer::streaming::release(asset.texture);
+    assetsImage.erase(assetsImage.begin() + index);
+}
+
 void love::Editor::ShowAssetBrowser(bool *p_open) {
     ImGui::Begin("Asset Browser");
 
@@ -349,6 +218,24 @@ void love::Editor::ShowAssetBrowser(bool *p_open) {
     }
     ImGui::PopItemWidth();
 
+    auto streamStats = renderer::streaming::stats();
+    if (streamStats.queued + streamStats.decoded + streamStats.uploading > 0) {
+        ImGui::Text(ICON_FA_SPINNER " %u queued, %u decoded, %u uploading | %.1f MB/s decode, %.1f MB/s upload",
+                    streamStats.queued, streamStats.decoded, streamStats.uploading, streamStats.decode_mb_s, streamStats.upload_mb_s);
+    }
+    VkDeviceSize assetBytes = 0;
+    for (const auto& asset : assetsImage)
+        assetBytes += asset.data.GpuBytes;
+    ImGui::Text("%zu images, %.1f MB on the GPU | registry %.1f of %.1f MB, %u cached, %llu hits, %llu evicted",
+                assetsImage.size(), assetBytes / (1024.0 * 1024.0), streamStats.resident_bytes / (1024.0 * 1024.0),
+                streamStats.budget_bytes / (1024.0 * 1024.0), streamStats.cached, (unsigned long long)streamStats.hits,
+                (unsigned long long)streamStats.evicted);
+    if (renderer::g_TextureCompressionBC) {
+        const renderer::cook::CookStats cookStats = renderer::cook::stats();
+        ImGui::Text("BCn: %u cooked in %.0f ms, %u from cache, %.1f MB as RGBA8 -> %.1f MB", cookStats.cooked, cookStats.cook_ms,
+                    cookStats.cache_hits, cookStats.source_bytes / (1024.0 * 1024.0), cookStats.cooked_bytes / (1024.0 * 1024.0));
+    }
+
     ImGui::PushStyleColor(ImGuiCol_ChildBg, ImGui::GetStyle().Colors[ImGuiCol_FrameBg]);
     auto displayWidth = ImGui::GetContentRegionAvail().x;
     if (ImGui::BeginChild("##FileDisplay", ImVec2(displayWidth, ImGui::GetContentRegionAvail().y))) {
@@ -357,15 +244,18 @@ void love::Editor::ShowAssetBrowser(bool *p_open) {
             if (b_eventFileDropped) {
                 SDL_Log("Dropped file: %s", c_eventFileDroppedName);
 
-                love::editor::ImageAsset imageAsset;
-                if (!LoadTextureFromFile(c_eventFileDroppedName, &imageAsset.data)) {
-                    SDL_Log("Error loading file image");
+                // decoding happens on the streaming workers, assets show the placeholder until they are uploaded
+                fs::path dropped = c_eventFileDroppedName;
+                if (fs::is_directory(dropped)) {
+                    for (const auto& entry : fs::directory_iterator(dropped))
+                        if (entry.is_regular_file())
+                            queueImageAsset(entry.path());
+                } else {
+                    queueImageAsset(dropped);
                 }
-                imageAsset.name = fs::path(c_eventFileDroppedName).filename();
-                assetsImage.push_back(imageAsset);
-                SDL_Log("Added image to assets");
             }
         }
+        updateImageAssets();
 
         /* This actually works except the y of childSize idk why
         ImVec2 parentPos = ImGui::GetCursorScreenPos(); // Position of the parent window (top-left)
@@ -390,6 +280,7 @@ void love::Editor::ShowAssetBrowser(bool *p_open) {
 
 
 
+        int removeIndex = -1;
         for (int i = 0; i < assetsImage.size(); i++) {
             auto& item = assetsImage[i];
             ImGui::PushID(i);
@@ -407,18 +298,27 @@ void love::Editor::ShowAssetBrowser(bool *p_open) {
             {
                 SDL_Log("%s", item.name.c_str());
             }
+            if (ImGui::BeginPopupContextItem()) {
+                if (ImGui::MenuItem(ICON_FA_TRASH " Remove"))
+                    removeIndex = i;
+                ImGui::EndPopup();
+            }
 
             if (asDetail)
                 ImGui::SameLine();
             ImGui::TextWrapped("%s", item.name.c_str());
             if (ImGui::IsItemHovered() && !asDetail)
                 ImGui::SetTooltip("%s", item.name.c_str());
+            if (asDetail && item.ready)
+                ImGui::TextDisabled("%dx%d, %.2f MB", item.data.Width, item.data.Height, item.data.GpuBytes / (1024.0 * 1024.0));
             ImGui::EndGroup();
 
 
             ImGui::PopID();
             ImGui::NextColumn();
         }
+        if (removeIndex >= 0)
+            removeImageAsset(removeIndex);
     }
     ImGui::EndChild();
     ImGui::PopStyleColor();
@@ -567,7 +467,7 @@ void love::Editor::showExplorer(bool *p_open) {
                     else if (extension == ".mp4" || extension == ".mov" || extension == ".avi") {
                         logo = ICON_FA_FILE_VIDEO;
                     }
-                    else if (extension == ".jpg" || extension == ".png" || extension == ".jpeg" || extension == ".gif" || extension == ".webp") {
+                    else if (extension == ".jpg" || extension == ".png" || extension == ".jpeg" || extension == ".gif" || extension == ".webp" || extension == ".ktx2") {
                         logo = ICON_FA_FILE_IMAGE;
                     }
                     else {
@@ -670,6 +570,180 @@ void love::Editor::showConsole(bool *p_open) {
     ImGui::End();
 }
 
+void love::Editor::showGpuProfiler(bool *p_open) {
+    ImGui::Begin("GPU Profiler", p_open);
+    if (!renderer::gpu_profiler::supported()) {
+        ImGui::TextWrapped("The graphics queue has no timestamp support on this device.");
+        ImGui::End();
+        return;
+    }
+
+    static std::vector<renderer::gpu_profiler::PassStats> passes;
+    renderer::gpu_profiler::stats(passes);
+    ImGui::Text("%u frames dropped while the GPU was behind", renderer::gpu_profiler::dropped_frames());
+    const renderer::barriers::BarrierStats barrier_stats = renderer::barriers::stats();
+    ImGui::Text("%llu barriers in %llu dependencies, %llu transitions elided", (unsigned long long)barrier_stats.barriers,
+                (unsigned long long)barrier_stats.dependencies, (unsigned long long)barrier_stats.elided);
+    const renderer::graph::GraphStats graph_stats = renderer::graph::stats();
+    ImGui::Text("Graph: %u passes, %u culled, %u merged, %u transients in %.1f of %.1f MB (%u rebuilds)", graph_stats.passes,
+                graph_stats.culled, graph_stats.merged, graph_stats.transients, graph_stats.allocated_bytes / (1024.0 * 1024.0),
+                graph_stats.transient_bytes / (1024.0 * 1024.0), graph_stats.rebuilds);
+
+    if (ImGui::BeginTable("##GpuPasses", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_SizingStretchProp)) {
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Avg ms");
+        ImGui::TableSetupColumn("p95 ms");
+        ImGui::TableSetupColumn("p99 ms");
+        ImGui::TableHeadersRow();
+        for (const auto& pass : passes) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(pass.name);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.last_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.avg_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.p95_ms);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", pass.p99_ms);
+        }
+        ImGui::EndTable();
+    }
+
+    for (const auto& pass : passes) {
+        ImGui::PlotLines(pass.name, pass.history, (int)pass.history_count, (int)pass.history_offset, nullptr,
+                         0.0f, pass.p99_ms * 1.25f, ImVec2(ImGui::GetContentRegionAvail().x * 0.8f, 48));
+    }
+
+    ImGui::End();
+}
+
+void love::Editor::showCpuProfiler(bool *p_open) {
+    ImGui::Begin("CPU Profiler", p_open);
+    if (!love::profiler::enabled()) {
+        ImGui::TextWrapped("Zones are compiled out, configure with -DLOVE_PROFILER=ON.");
+        ImGui::End();
+        return;
+    }
+
+    // the last complete frame, kept while paused
+    static std::vector<love::profiler::ThreadZones> threads;
+    static uint64_t frameStart = 0, frameEnd = 0;
+    if (!b_cpuProfilerPaused && love::profiler::last_frame(frameStart, frameEnd))
+        love::profiler::collect(frameStart, frameEnd, threads);
+
+    ImGui::Checkbox("Pause", &b_cpuProfilerPaused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace")) {
+        if (love::profiler::write_chrome_trace("love_trace.json"))
+            log(editor::LogType::Info, "CPU trace written to love_trace.json");
+        else
+            log(editor::LogType::Error, "Could not write love_trace.json");
+    }
+    const double frameMs = love::profiler::ticks_to_ms(frameEnd - frameStart);
+    ImGui::SameLine();
+    ImGui::Text("Frame %.3f ms", frameMs);
+    if (frameEnd <= frameStart) {
+        ImGui::End();
+        return;
+    }
+
+    // one lane per thread, one row per nesting depth, x is time within the frame
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    const float width = ImGui::GetContentRegionAvail().x;
+    const double scale = width / (double)(frameEnd - frameStart);
+    for (const auto& thread : threads) {
+        if (thread.name)
+            ImGui::Text("%s", thread.name);
+        else
+            ImGui::Text("Thread %u", thread.thread);
+
+        uint32_t rows = 1;
+        for (const auto& event : thread.events)
+            rows = std::max(rows, event.depth + 1);
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton(("##lane" + std::to_string(thread.thread)).c_str(), ImVec2(width, rows * rowHeight));
+        const bool laneHovered = ImGui::IsItemHovered();
+        const ImVec2 mouse = ImGui::GetIO().MousePos;
+
+        for (const auto& event : thread.events) {
+            const uint64_t start = std::max(event.start, frameStart);
+            const uint64_t end = std::min(event.end, frameEnd);
+            const ImVec2 min(origin.x + (float)((start - frameStart) * scale), origin.y + event.depth * rowHeight);
+            const ImVec2 max(std::max(min.x + 1.0f, origin.x + (float)((end - frameStart) * scale)), min.y + rowHeight - 1.0f);
+            // color by name so the same zone keeps its color between frames
+            uint32_t hash = 2166136261u;
+            for (const char* c = event.name; *c; c++)
+                hash = (hash ^ (uint8_t)*c) * 16777619u;
+            const ImU32 color = ImGui::ColorConvertFloat4ToU32(ImVec4(
+                    0.35f + 0.4f * ((hash >> 0) & 0xff) / 255.0f,
+                    0.35f + 0.4f * ((hash >> 8) & 0xff) / 255.0f,
+                    0.35f + 0.4f * ((hash >> 16) & 0xff) / 255.0f, 1.0f));
+            drawList->AddRectFilled(min, max, color);
+            if (ImGui::CalcTextSize(event.name).x < max.x - min.x - 4.0f)
+                drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), event.name);
+            if (laneHovered && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y)
+                ImGui::SetTooltip("%s\n%.3f ms", event.name, love::profiler::ticks_to_ms(event.end - event.start));
+        }
+    }
+
+    ImGui::End();
+}
+
+void love::Editor::showFramePacing(bool *p_open) {
+    ImGui::Begin("Frame Pacing", p_open);
+
+    if (!renderer::g_Headless) {
+        const VkSurfaceKHR surface = renderer::swapchain::surface();
+        const VkPresentModeKHR requested = renderer::pacing::requested_present_mode();
+        if (ImGui::BeginCombo("Present mode", renderer::pacing::present_mode_name(requested))) {
+            const VkPresentModeKHR modes[] = {VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+                                              VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+            for (VkPresentModeKHR mode : modes) {
+                const bool supported = mode == VK_PRESENT_MODE_FIFO_KHR || renderer::pacing::present_mode_supported(surface, mode);
+                if (ImGui::Selectable(renderer::pacing::present_mode_name(mode), mode == requested,
+                                      supported ? 0 : ImGuiSelectableFlags_Disabled))
+                    renderer::pacing::set_present_mode(mode);
+            }
+            ImGui::EndCombo();
+        }
+        int images = (int)renderer::g_MinImageCount;
+        if (ImGui::SliderInt("Swapchain images", &images, 2, 4)) {
+            renderer::g_MinImageCount = (uint32_t)images;
+            renderer::g_SwapChainRebuild = true;
+        }
+        ImGui::SetItemTooltip("Mailbox needs at least 3 to never block on present");
+    }
+
+    int frames = (int)renderer::pacing::frames_in_flight();
+    if (ImGui::SliderInt("CPU frames in flight", &frames, 1, MAX_INFLIGHT_FRAMES))
+        renderer::pacing::set_frames_in_flight((uint32_t)frames);
+    float target = renderer::pacing::target_frame_ms();
+    if (ImGui::DragFloat("Target frame time", &target, 0.05f, 0.0f, 100.0f, target > 0.0f ? "%.2f ms" : "off"))
+        renderer::pacing::set_target_frame_ms(target);
+
+    const renderer::pacing::PacingStats stats = renderer::pacing::stats();
+    ImGui::SeparatorText("Last 240 frames");
+    ImGui::Text("Frame    %.3f ms avg, %.3f ms p95 (%.1f fps)", stats.frame_ms, stats.frame_p95_ms,
+                stats.frame_ms > 0.0f ? 1000.0f / stats.frame_ms : 0.0f);
+    ImGui::Text("CPU      %.3f ms", stats.cpu_ms);
+    ImGui::Text("Throttle %.3f ms waiting on the GPU", stats.throttle_ms);
+    ImGui::Text("Limiter  %.3f ms sleeping", stats.limiter_ms);
+    ImGui::Text("Latency  %.3f ms avg, %.3f ms p95 from frame start to GPU done", stats.latency_ms, stats.latency_p95_ms);
+    if (!renderer::g_Headless) {
+        const renderer::swapchain::RecreateStats rebuilds = renderer::swapchain::recreate_stats();
+        ImGui::Text("Swapchain %ux%u, %u images, %s", renderer::swapchain::width(), renderer::swapchain::height(),
+                    renderer::swapchain::image_count(), renderer::pacing::present_mode_name(renderer::swapchain::present_mode()));
+        ImGui::Text("Rebuilds %u, last %.3f ms, avg %.3f ms, max %.3f ms", rebuilds.count, rebuilds.last_ms,
+                    rebuilds.avg_ms, rebuilds.max_ms);
+    }
+
+    ImGui::End();
+}
+
 void love::Editor::log(love::editor::LogType type, std::string msg) {
     love::editor::LogItem item;
     item.message = std::string(msg);
@@ -13,6 +13,10 @@
 #include <vector>
 
 #include "../Renderer/Renderer.h"
+#include "../Renderer/TextureStreamer.h"
+#include "../Renderer/GpuProfiler.h"
+#include "../Renderer/FramePacing.h"
+#include "../Renderer/Swapchain.h"
 #include "../debug_panic.h"
 
 
@@ -24,20 +28,13 @@
 
 struct MyTextureData
 {
-    VkDescriptorSet DS;         // Descriptor set: this is what you'll pass to Image()
-    int             Width;
-    int             Height;
-    int             Channels;
-
-    // Need to keep track of these to properly cleanup
-    VkImageView     ImageView;
-    VkImage         Image;
-    VkDeviceMemory  ImageMemory;
-    VkSampler       Sampler;
-    VkBuffer        UploadBuffer;
-    VkDeviceMemory  UploadBufferMemory;
-
-    MyTextureData() { memset(this, 0, sizeof(*this)); }
+    VkDescriptorSet DS = VK_NULL_HANDLE;    // Descriptor set: this is what you'll pass to Image()
+    int             Width = 0;
+    int             Height = 0;
+    int             Channels = 0;
+
+    // the image itself is owned by the texture streamer, ImageAsset keeps its handle
+    VkDeviceSize    GpuBytes = 0;           // size of the image's VMA allocation, mips included
 };
 
 namespace love {
@@ -47,6 +44,8 @@ namespace love {
             MyTextureData data;
             std::string path;
             std::string name;
+            renderer::streaming::TextureHandle texture = renderer::streaming::INVALID_TEXTURE;
+            bool ready = false; // data.DS points at the streamed texture instead of the placeholder
         };
 
         enum class LogType {
@@ -91,6 +90,9 @@ namespace love {
     private:
         SDL_Renderer* renderer;
         std::vector<love::editor::ImageAsset> assetsImage;
+        // shared by every streamed asset thumbnail
+        VkSampler assetSampler = VK_NULL_HANDLE;
+        VkDescriptorSet placeholderDS = VK_NULL_HANDLE;
 
 
         void SetupImGuiStyle(love::editor::Theme theme);
@@ -113,6 +115,10 @@ namespace love {
 
         bool b_assetBrowserShow = true;
         bool b_consoleShow = true;
+        bool b_gpuProfilerShow = false;
+        bool b_cpuProfilerShow = false;
+        bool b_cpuProfilerPaused = false;
+        bool b_framePacingShow = false;
         bool b_scrollToBottom = false;
         char* c_consoleInputBuffer;
         const size_t t_consoleInputBufferSize = 1024;
@@ -121,6 +127,12 @@ namespace love {
         void showExplorer(bool *p_open);
         void ShowAssetBrowser(bool *p_open);
         void showConsole(bool *p_open);
+        void showGpuProfiler(bool *p_open);
+        void showCpuProfiler(bool *p_open);
+        void showFramePacing(bool *p_open);
+        void queueImageAsset(const std::filesystem::path& path);
+        void updateImageAssets();
+        void removeImageAsset(size_t index);
 
 
 
@@ -0,0 +1,153 @@
+#include "love_profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+namespace love::profiler {
+#ifdef LOVE_PROFILER_ENABLED
+    namespace {
+        constexpr uint64_t buffer_size = 1 << 16;
+        // slots this close to the writer may be overwritten while being read, readers skip them
+        constexpr uint64_t read_margin = 1024;
+
+        struct ThreadBuffer {
+            uint32_t index;
+            const char *name = nullptr;
+            std::atomic<uint64_t> head = 0; // zones ever written, the next one goes to head % buffer_size
+            ZoneEvent events[buffer_size];
+        };
+
+        std::mutex registryMutex;
+        // kept after their threads exit so the trace export still sees them
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        thread_local ThreadBuffer *local = nullptr;
+        thread_local uint32_t depth = 0;
+
+        const uint64_t originTicks = now();
+        const std::chrono::steady_clock::time_point originClock = std::chrono::steady_clock::now();
+        uint64_t frameStart = 0, lastFrameStart = 0, lastFrameEnd = 0;
+
+        ThreadBuffer &thread_buffer() {
+            if (!local) {
+                std::lock_guard lock(registryMutex);
+                buffers.push_back(std::make_unique<ThreadBuffer>());
+                local = buffers.back().get();
+                local->index = (uint32_t)buffers.size() - 1;
+            }
+            return *local;
+        }
+        std::vector<ThreadBuffer *> snapshot() {
+            std::lock_guard lock(registryMutex);
+            std::vector<ThreadBuffer *> result;
+            for (auto &buffer : buffers)
+                result.push_back(buffer.get());
+            return result;
+        }
+        // ticks per millisecond, measured against steady_clock over the whole run so far
+        double tick_rate() {
+            const uint64_t ticks = now() - originTicks;
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - originClock).count();
+            return ms > 0 && ticks > 0 ? (double)ticks / ms : 1e6;
+        }
+        // visits readable events newest first until visit returns false
+        template<class F>
+        void for_each_event(const ThreadBuffer &buffer, F &&visit) {
+            const uint64_t head = buffer.head.load(std::memory_order_acquire);
+            const uint64_t oldest = head > buffer_size - read_margin ? head - (buffer_size - read_margin) : 0;
+            for (uint64_t i = head; i > oldest; i--)
+                if (!visit(buffer.events[(i - 1) % buffer_size]))
+                    return;
+        }
+    }
+
+    double ticks_to_ms(uint64_t ticks) {
+        return (double)ticks / tick_rate();
+    }
+    bool enabled() {
+        return true;
+    }
+    void set_thread_name(const char *name) {
+        thread_buffer().name = name;
+    }
+    void frame_mark() {
+        const uint64_t tick = now();
+        lastFrameStart = frameStart;
+        lastFrameEnd = tick;
+        frameStart = tick;
+    }
+    bool last_frame(uint64_t &start, uint64_t &end) {
+        start = lastFrameStart;
+        end = lastFrameEnd;
+        return start != 0;
+    }
+
+    void collect(uint64_t start, uint64_t end, std::vector<ThreadZones> &out) {
+        out.clear();
+        for (ThreadBuffer *buffer : snapshot()) {
+            ThreadZones zones = {buffer->index, buffer->name, {}};
+            // events are ordered by their end, so everything past the first one ending before start is older
+            for_each_event(*buffer, [&](const ZoneEvent &event) {
+                if (event.end < start)
+                    return false;
+                if (event.start <= end)
+                    zones.events.push_back(event);
+                return true;
+            });
+            if (!zones.events.empty())
+                out.push_back(std::move(zones));
+        }
+    }
+
+    bool write_chrome_trace(const char *path) {
+        const double rate = tick_rate();
+        nlohmann::json events = nlohmann::json::array();
+        for (ThreadBuffer *buffer : snapshot()) {
+            if (buffer->name) {
+                events.push_back({{"name", "thread_name"}, {"ph", "M"}, {"pid", 1}, {"tid", buffer->index},
+                                  {"args", {{"name", buffer->name}}}});
+            }
+            for_each_event(*buffer, [&](const ZoneEvent &event) {
+                events.push_back({
+                    {"name", event.name},
+                    {"ph", "X"},
+                    {"pid", 1},
+                    {"tid", buffer->index},
+                    {"ts", (double)(event.start - originTicks) / rate * 1000.0},
+                    {"dur", (double)(event.end - event.start) / rate * 1000.0},
+                });
+                return true;
+            });
+        }
+        std::ofstream file(path);
+        if (!file)
+            return false;
+        file << nlohmann::json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}}.dump() << '\n';
+        return (bool)file;
+    }
+
+    uint32_t enter_zone() {
+        return depth++;
+    }
+    void leave_zone(const char *name, uint64_t start, uint32_t zone_depth) {
+        const uint64_t end = now();
+        depth = zone_depth;
+        ThreadBuffer &buffer = thread_buffer();
+        const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+        buffer.events[head % buffer_size] = {name, start, end, zone_depth};
+        buffer.head.store(head + 1, std::memory_order_release);
+    }
+#else
+    double ticks_to_ms(uint64_t ticks) { return 0; }
+    bool enabled() { return false; }
+    void set_thread_name(const char *) {}
+    void frame_mark() {}
+    bool last_frame(uint64_t &start, uint64_t &end) { start = end = 0; return false; }
+    void collect(uint64_t, uint64_t, std::vector<ThreadZones> &out) { out.clear(); }
+    bool write_chrome_trace(const char *) { return false; }
+    uint32_t enter_zone() { return 0; }
+    void leave_zone(const char *, uint64_t, uint32_t) {}
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef LOVE_PROFILER_H
+#define LOVE_PROFILER_H
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * CPU zone profiler. Every thread writes finished zones into its own ring buffer that no other thread writes,
+ * so recording a zone is two timestamp reads and one store without locks. Readers (the flame view, the Chrome
+ * trace export) only look at slots the writer is not about to reuse.
+ * Without LOVE_PROFILER_ENABLED, LOVE_ZONE expands to nothing and the functions below are empty.
+ */
+namespace love::profiler {
+    /// TSC ticks on x86, steady_clock ticks elsewhere
+    inline uint64_t now() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+    double ticks_to_ms(uint64_t ticks);
+
+    struct ZoneEvent {
+        const char *name;
+        uint64_t start, end;
+        uint32_t depth;
+    };
+    struct ThreadZones {
+        uint32_t thread;        // profiler thread index, in order of the first recorded zone
+        const char *name;       // nullptr unless the thread called set_thread_name
+        std::vector<ZoneEvent> events;
+    };
+
+    bool enabled();
+    /// name has to outlive the profiler, usually a string literal
+    void set_thread_name(const char *name);
+    /// start of a main loop iteration, the previous iteration becomes last_frame()
+    void frame_mark();
+    bool last_frame(uint64_t &start, uint64_t &end);
+    /// zones of every thread that overlap [start, end]
+    void collect(uint64_t start, uint64_t end, std::vector<ThreadZones> &out);
+    /// everything still in the ring buffers as Chrome trace event JSON (chrome://tracing, Perfetto)
+    bool write_chrome_trace(const char *path);
+
+    uint32_t enter_zone();
+    void leave_zone(const char *name, uint64_t start, uint32_t depth);
+
+    class Zone {
+    public:
+        explicit Zone(const char *name) : name(name), depth(enter_zone()), start(now()) {}
+        ~Zone() { leave_zone(name, start, depth); }
+        Zone(const Zone &) = delete;
+        Zone &operator=(const Zone &) = delete;
+    private:
+        const char *name;
+        uint32_t depth;
+        uint64_t start;
+    };
+}
+
+#ifdef LOVE_PROFILER_ENABLED
+#define LOVE_ZONE_CONCAT_(a, b) a##b
+#define LOVE_ZONE_CONCAT(a, b) LOVE_ZONE_CONCAT_(a, b)
+/// profiles the rest of the enclosing scope, name must be a string literal
+#define LOVE_ZONE(name) ::love::profiler::Zone LOVE_ZONE_CONCAT(love_zone_, __LINE__)(name)
+#else
+#define LOVE_ZONE(name) ((void)0)
+#endif
+#endif //LOVE_PROFILER_H
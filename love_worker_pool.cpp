@@ -0,0 +1,77 @@
+#include "love_worker_pool.h"
+#include <algorithm>
+#include <atomic>
+
+WorkerPool::WorkerPool(uint32_t thread_count) {
+    threads.reserve(thread_count);
+    for (uint32_t i = 0; i < thread_count; i++)
+        threads.emplace_back([this, i] { run(i); });
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads)
+        t.join();
+}
+
+uint32_t WorkerPool::pending() const {
+    std::lock_guard lock(mutex);
+    return (uint32_t)tasks.size();
+}
+
+void WorkerPool::submit(Task task) {
+    {
+        std::lock_guard lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void WorkerPool::parallel_for(uint32_t count, const std::function<void(uint32_t job, uint32_t worker)>& fn) {
+    if (count == 0) return;
+    std::atomic<uint32_t> next = 0;
+    uint32_t finished = 0;
+    std::mutex done_mutex;
+    std::condition_variable done;
+
+    // one claiming loop per worker instead of one task per job keeps queue traffic independent of count
+    const uint32_t loops = std::min(count, size());
+    {
+        std::lock_guard lock(mutex);
+        for (uint32_t i = 0; i < loops; i++) {
+            tasks.emplace_back([&](uint32_t worker) {
+                for (uint32_t job = next.fetch_add(1); job < count; job = next.fetch_add(1))
+                    fn(job, worker);
+                std::lock_guard done_lock(done_mutex);
+                if (++finished == loops) done.notify_one();
+            });
+        }
+    }
+    wake.notify_all();
+
+    std::unique_lock lock(done_mutex);
+    done.wait(lock, [&] { return finished == loops; });
+}
+
+uint32_t WorkerPool::default_thread_count(uint32_t max) {
+    const uint32_t hw = std::thread::hardware_concurrency();
+    return std::clamp(hw > 1 ? hw - 1 : 1u, 1u, max);
+}
+
+void WorkerPool::run(uint32_t worker) {
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task(worker);
+    }
+}
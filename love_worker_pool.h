@@ -0,0 +1,47 @@
+#ifndef LOVE_WORKER_POOL_H
+#define LOVE_WORKER_POOL_H
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads. Tasks get the index of the worker running them so callers can keep
+ * per-thread state (command pools, scratch memory) without locking.
+ */
+class WorkerPool {
+public:
+    using Task = std::function<void(uint32_t worker)>;
+
+    explicit WorkerPool(uint32_t thread_count);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t size() const { return (uint32_t)threads.size(); }
+    /// queued but not yet started tasks
+    uint32_t pending() const;
+
+    void submit(Task task);
+    /**
+     * runs fn(job, worker) for every job in [0, count) and blocks until all of them finished
+     * @param fn called concurrently from the workers, jobs are claimed in increasing order
+     */
+    void parallel_for(uint32_t count, const std::function<void(uint32_t job, uint32_t worker)>& fn);
+
+    /// hardware threads minus the caller, clamped to [1, max]
+    static uint32_t default_thread_count(uint32_t max = 8);
+
+private:
+    void run(uint32_t worker);
+
+    std::vector<std::thread> threads;
+    std::deque<Task> tasks;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+#endif //LOVE_WORKER_POOL_H
@@ -36,16 +36,35 @@
 
 // This example doesn't compile with Emscripten yet! Awaiting SDL3 support.
 
-//#define APP_USE_UNLIMITED_FRAME_RATE
 
 // Data
 
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 #include "editor/editor.hpp"
 #include "Renderer/Renderer.h"
 #include "Renderer/ResourceManager.h"
+#include "Renderer/GpuTimeline.h"
+#include "Renderer/ParallelRecorder.h"
+#include "Renderer/StagingRing.h"
+#include "Renderer/FrameAllocator.h"
+#include "Renderer/MipGenerator.h"
+#include "Renderer/TextureStreamer.h"
+#include "Renderer/TextureCooker.h"
+#include "Renderer/PipelineCache.h"
+#include "Renderer/Headless.h"
+#include "Renderer/GpuProfiler.h"
+#include "Renderer/FramePacing.h"
+#include "Renderer/Swapchain.h"
+#include "Renderer/SpriteBatcher.h"
+#include "Renderer/RenderGraph.h"
+#include "Renderer/EngineImage.h"
+#include "love_profiler.h"
 
 
 static love::Editor* editor;
@@ -61,108 +80,298 @@ static void check_vk_result(VkResult err)
 
 
 
-static void FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
+// What FrameRender draws into, a swapchain image or a headless offscreen image
+struct FrameTarget
+{
+    VkCommandPool   CommandPool;
+    VkCommandBuffer CommandBuffer;
+    VkFence         Fence;
+    VkImage         Image;
+    VkImageView     ImageView;
+    VkImageLayout   FinalLayout;                // PRESENT_SRC for swapchain images, TRANSFER_SRC for headless ones
+    uint32_t        Width;
+    uint32_t        Height;
+    VkSemaphore     ImageAcquiredSemaphore;     // VK_NULL_HANDLE for headless targets
+    VkSemaphore     RenderCompleteSemaphore;    // VK_NULL_HANDLE for headless targets
+};
+
+static bool AcquireFrameTarget(FrameTarget* target)
+{
+    if (renderer::g_Headless)
+    {
+        renderer::headless::HeadlessFrame& frame = renderer::headless::next_frame();
+        *target = { frame.command_pool, frame.command_buffer, frame.fence, frame.image, frame.view, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    renderer::headless::width(), renderer::headless::height(), VK_NULL_HANDLE, VK_NULL_HANDLE };
+        return true;
+    }
+
+    renderer::swapchain::AcquiredFrame acquired;
+    if (!renderer::swapchain::acquire(acquired))
+        return false;
+    renderer::swapchain::SwapchainFrame* fd = acquired.frame;
+    *target = { fd->command_pool, fd->command_buffer, fd->fence, fd->image, fd->view, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                renderer::swapchain::width(), renderer::swapchain::height(), acquired.image_acquired, acquired.render_complete };
+    return true;
+}
+
+static void FrameRender(const VkClearValue& clear_value, ImDrawData* draw_data)
 {
     VkResult err;
 
-    VkSemaphore image_acquired_semaphore  = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
-    VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
-    err = vkAcquireNextImageKHR(renderer::device, wd->Swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE, &wd->FrameIndex);
-    if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
+    FrameTarget target;
     {
-        renderer::g_SwapChainRebuild = true;
-        return;
+        LOVE_ZONE("Acquire image");
+        if (!AcquireFrameTarget(&target))
+            return;
     }
-    check_vk_result(err);
-
-    ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
     {
-        err = vkWaitForFences(renderer::device, 1, &fd->Fence, VK_TRUE, UINT64_MAX);    // wait indefinitely instead of periodically checking
+        LOVE_ZONE("Wait frame fence");
+        err = vkWaitForFences(renderer::device, 1, &target.Fence, VK_TRUE, UINT64_MAX);    // wait indefinitely instead of periodically checking
         check_vk_result(err);
 
-        err = vkResetFences(renderer::device, 1, &fd->Fence);
+        err = vkResetFences(renderer::device, 1, &target.Fence);
         check_vk_result(err);
     }
     {
-        err = vkResetCommandPool(renderer::device, fd->CommandPool, 0);
+        err = vkResetCommandPool(renderer::device, target.CommandPool, 0);
         check_vk_result(err);
         VkCommandBufferBeginInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
         info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        err = vkBeginCommandBuffer(fd->CommandBuffer, &info);
+        err = vkBeginCommandBuffer(target.CommandBuffer, &info);
         check_vk_result(err);
+        renderer::gpu_profiler::begin_frame(target.CommandBuffer);
     }
     {
-        VkRenderPassBeginInfo info = {};
-        info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        info.renderPass = wd->RenderPass;
-        info.framebuffer = fd->Framebuffer;
-        info.renderArea.extent.width = wd->Width;
-        info.renderArea.extent.height = wd->Height;
-        info.clearValueCount = 1;
-        info.pClearValues = &wd->ClearValue;
-        vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+        // the backbuffer starts undefined at the stage the image acquired wait below blocks, so the first barrier
+        // runs after the presentation engine lets go; present or a headless readback in a later submit waits on
+        // the semaphore or fence, which covers all commands
+        namespace graph = renderer::graph;
+        graph::begin();
+        const renderer::barriers::SubresourceState acquired = { VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+                                                               VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE };
+        const VkFormat format = renderer::g_Headless ? renderer::headless::format() : renderer::swapchain::surface_format().format;
+        graph::Resource backbuffer = graph::import_image("Backbuffer", target.Image, target.ImageView, { target.Width, target.Height, format }, acquired,
+                                                         target.FinalLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+                                                             ? renderer::barriers::ImageAccess::Present
+                                                             : renderer::barriers::ImageAccess::CopySrc);
+
+        // Sprites go under the editor UI, recorded in parallel when there are any. Without sprites the pass is only
+        // the clear, in an ordinary scope the ImGui pass continues
+        const uint32_t width = target.Width, height = target.Height;
+        const bool parallel_sprites = renderer::sprites::submitted() > 0;
+        graph::Pass sprites = graph::add_pass("Sprites", [width, height, parallel_sprites](VkCommandBuffer cb) {
+            if (parallel_sprites)
+                renderer::sprites::record(cb, graph::rendering_inheritance(), width, height);
+            else
+                renderer::sprites::record(cb, width, height);
+        });
+        graph::color(sprites, backbuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, clear_value.color);
+        if (parallel_sprites)
+            graph::secondaries(sprites);
+
+        // Record dear imgui primitives into command buffer
+        graph::Pass imgui = graph::add_pass("ImGui", [draw_data](VkCommandBuffer cb) {
+            ImGui_ImplVulkan_RenderDrawData(draw_data, cb);
+        });
+        graph::color(imgui, backbuffer, VK_ATTACHMENT_LOAD_OP_LOAD);
+
+        graph::execute(target.CommandBuffer);
     }
 
-    // Record dear imgui primitives into command buffer
-    ImGui_ImplVulkan_RenderDrawData(draw_data, fd->CommandBuffer);
-
     // Submit command buffer
-    vkCmdEndRenderPass(fd->CommandBuffer);
     {
-        VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        // this frame's staging copies go first in the same batch so textures are ready before they are drawn,
+        // with a transfer queue the batch waits for its copies and starts with the ownership acquires
+        VkCommandBuffer command_buffers[2];
+        uint32_t command_buffer_count = 0;
+        renderer::staging::FrameUploads uploads = renderer::staging::finish_frame();
+        if (uploads.cb != VK_NULL_HANDLE)
+            command_buffers[command_buffer_count++] = uploads.cb;
+        command_buffers[command_buffer_count++] = target.CommandBuffer;
+        renderer::linear::flush();
+
+        VkSemaphore wait_semaphores[2];
+        VkPipelineStageFlags wait_stages[2];
+        uint64_t wait_values[2];
+        uint32_t wait_count = 0;
+        if (target.ImageAcquiredSemaphore != VK_NULL_HANDLE)
+        {
+            wait_semaphores[wait_count] = target.ImageAcquiredSemaphore;
+            wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            wait_values[wait_count++] = 0;
+        }
+        if (uploads.wait_semaphore != VK_NULL_HANDLE)
+        {
+            wait_semaphores[wait_count] = uploads.wait_semaphore;
+            wait_stages[wait_count] = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            wait_values[wait_count++] = uploads.wait_value;
+        }
         VkSubmitInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        info.waitSemaphoreCount = 1;
-        info.pWaitSemaphores = &image_acquired_semaphore;
-        info.pWaitDstStageMask = &wait_stage;
-        info.commandBufferCount = 1;
-        info.pCommandBuffers = &fd->CommandBuffer;
-        info.signalSemaphoreCount = 1;
-        info.pSignalSemaphores = &render_complete_semaphore;
-
-        err = vkEndCommandBuffer(fd->CommandBuffer);
-        check_vk_result(err);
-        err = vkQueueSubmit(renderer::g_Queue, 1, &info, fd->Fence);
+        info.waitSemaphoreCount = wait_count;
+        info.pWaitSemaphores = wait_semaphores;
+        info.pWaitDstStageMask = wait_stages;
+        info.commandBufferCount = command_buffer_count;
+        info.pCommandBuffers = command_buffers;
+        info.signalSemaphoreCount = target.RenderCompleteSemaphore != VK_NULL_HANDLE ? 1 : 0;
+        info.pSignalSemaphores = &target.RenderCompleteSemaphore;
+
+        err = vkEndCommandBuffer(target.CommandBuffer);
         check_vk_result(err);
+        renderer::gpu_profiler::end_frame();
+        renderer::timeline::submit(renderer::g_Queue, info, target.Fence, wait_values);
     }
 }
 
-static void FramePresent(ImGui_ImplVulkanH_Window* wd)
+static void FramePresent()
 {
-    if (renderer::g_SwapChainRebuild)
-        return;
-    VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
-    VkPresentInfoKHR info = {};
-    info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    info.waitSemaphoreCount = 1;
-    info.pWaitSemaphores = &render_complete_semaphore;
-    info.swapchainCount = 1;
-    info.pSwapchains = &wd->Swapchain;
-    info.pImageIndices = &wd->FrameIndex;
-    VkResult err = vkQueuePresentKHR(renderer::g_Queue, &info);
-    if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
+    if (!renderer::g_Headless)
+        renderer::swapchain::present();
+}
+
+// Sprite throughput benchmark, --sprites N keeps N sprites moving every frame
+struct SpriteBenchmark
+{
+    EngineImage*                     Image = nullptr;
+    renderer::sprites::SpriteTexture Texture = renderer::sprites::INVALID_SPRITE_TEXTURE;
+    uint32_t                         Count = 0;
+};
+static SpriteBenchmark g_SpriteBenchmark;
+
+static void CreateSpriteBenchmark(uint32_t count)
+{
+    // soft edged white disc, the sprites tint it
+    const uint32_t size = 32;
+    uint8_t* pixels = (uint8_t*)malloc(size * size * 4);
+    for (uint32_t y = 0; y < size; y++)
+        for (uint32_t x = 0; x < size; x++)
+        {
+            const float dx = (float)x + 0.5f - size * 0.5f, dy = (float)y + 0.5f - size * 0.5f;
+            const float alpha = std::clamp(size * 0.5f - sqrtf(dx * dx + dy * dy), 0.0f, 1.0f);
+            uint8_t* texel = pixels + (y * size + x) * 4;
+            texel[0] = texel[1] = texel[2] = 255;
+            texel[3] = (uint8_t)(alpha * 255.0f);
+        }
+    g_SpriteBenchmark.Image = EngineImage::make_from_pixels(pixels, size, size, 4, VK_IMAGE_USAGE_SAMPLED_BIT, true, free);
+    g_SpriteBenchmark.Texture = renderer::sprites::add_texture(*g_SpriteBenchmark.Image);
+    g_SpriteBenchmark.Count = count;
+}
+
+static void SubmitSpriteBenchmark(float time, uint32_t width, uint32_t height)
+{
+    // every sprite follows its own Lissajous curve over the target, spread over 4 layers
+    renderer::sprites::Sprite sprite = {};
+    sprite.texture = g_SpriteBenchmark.Texture;
+    sprite.width = sprite.height = 8.0f;
+    for (uint32_t i = 0; i < g_SpriteBenchmark.Count; i++)
     {
-        renderer::g_SwapChainRebuild = true;
+        const float phase = (float)i * 0.618034f;
+        sprite.x = width * (0.5f + 0.45f * sinf(time * (0.31f + (i % 7) * 0.05f) + phase));
+        sprite.y = height * (0.5f + 0.45f * cosf(time * (0.23f + (i % 11) * 0.04f) + phase * 1.7f));
+        sprite.rotation = time + phase;
+        sprite.color = 0x80000000u | (i * 2654435761u & 0x00FFFFFFu);
+        sprite.layer = (uint16_t)(i & 3);
+        renderer::sprites::submit(sprite);
+    }
+}
+
+static void DestroySpriteBenchmark()
+{
+    if (!g_SpriteBenchmark.Image)
         return;
+    renderer::sprites::remove_texture(g_SpriteBenchmark.Texture);
+    g_SpriteBenchmark.Image->destroy();
+    delete g_SpriteBenchmark.Image;
+    g_SpriteBenchmark.Image = nullptr;
+}
+
+// --headless [--frames N] [--size WxH] [--stats file.json] [--trace file.json] [--sprites N] [--record-threads N]
+// [--present-mode fifo|relaxed|mailbox|immediate] [--frames-in-flight N] [--swapchain-images N] [--fps N]
+struct HeadlessOptions
+{
+    const char* TracePath = nullptr;    // CPU zones as Chrome trace JSON, written at exit (windowed runs too)
+    uint32_t    Sprites = 0;            // sprite benchmark size, windowed runs too
+    uint32_t    RecordThreads = 0;      // parallel recording threads, 0 picks from the core count
+    uint32_t    Frames = 300;
+    uint32_t    Width = 1280;
+    uint32_t    Height = 720;
+    const char* StatsPath = nullptr;
+};
+
+static bool ParseArgs(int argc, char** argv, HeadlessOptions* options)
+{
+    VkPresentModeKHR present_mode;
+    for (int i = 1; i < argc; i++)
+    {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--headless") == 0)
+            renderer::g_Headless = true;
+        else if (strcmp(argv[i], "--frames") == 0 && has_value)
+            options->Frames = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--size") == 0 && has_value && sscanf(argv[i + 1], "%ux%u", &options->Width, &options->Height) == 2)
+            i++;
+        else if (strcmp(argv[i], "--stats") == 0 && has_value)
+            options->StatsPath = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && has_value)
+            options->TracePath = argv[++i];
+        else if (strcmp(argv[i], "--sprites") == 0 && has_value)
+            options->Sprites = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--record-threads") == 0 && has_value)
+            options->RecordThreads = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--present-mode") == 0 && has_value && renderer::pacing::parse_present_mode(argv[i + 1], &present_mode))
+        {
+            renderer::pacing::set_present_mode(present_mode);
+            i++;
+        }
+        else if (strcmp(argv[i], "--frames-in-flight") == 0 && has_value)
+            renderer::pacing::set_frames_in_flight((uint32_t)strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--swapchain-images") == 0 && has_value)
+            renderer::g_MinImageCount = std::max<uint32_t>(2, (uint32_t)strtoul(argv[++i], nullptr, 10));
+        else if (strcmp(argv[i], "--fps") == 0 && has_value)
+        {
+            const float fps = strtof(argv[++i], nullptr);
+            renderer::pacing::set_target_frame_ms(fps > 0.0f ? 1000.0f / fps : 0.0f);
+        }
+        else
+        {
+            SDL_Log("Usage: %s [--headless [--frames N] [--size WxH] [--stats file.json]] [--trace file.json] [--sprites N] "
+                    "[--record-threads N] [--present-mode fifo|relaxed|mailbox|immediate] [--frames-in-flight N] [--swapchain-images N] [--fps N]", argv[0]);
+            return false;
+        }
     }
-    check_vk_result(err);
-    wd->SemaphoreIndex = (wd->SemaphoreIndex + 1) % wd->SemaphoreCount; // Now we can use the next set of semaphores
+    return options->Frames > 0 && options->Width > 0 && options->Height > 0;
 }
 
 // Main code
-int main(int, char**)
+int main(int argc, char** argv)
 {
 
     SDL_SetLogPriorities(SDL_LogPriority::SDL_LOG_PRIORITY_DEBUG);
 
-    // Setup SDL
-    if (!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMEPAD) != 0)
+    HeadlessOptions headless_options;
+    if (!ParseArgs(argc, argv, &headless_options))
+        return -1;
+
+    // Setup SDL, headless runs need neither video nor input
+    if (!SDL_Init(renderer::g_Headless ? 0 : SDL_INIT_VIDEO | SDL_INIT_GAMEPAD) != 0)
     {
         SDL_Log("Error: SDL_Init(): %s\n", SDL_GetError());
         return -1;
     }
     renderer::init();
+    if (renderer::g_Headless)
+        renderer::headless::init(headless_options.Width, headless_options.Height);
+    renderer::parallel::init(headless_options.RecordThreads);
+    init_frame_resource_manager(renderer::parallel::thread_count());
+    renderer::staging::init();
+    renderer::linear::init();
+    renderer::cook::init();
+    renderer::streaming::init();
+    renderer::gpu_profiler::init();
+    renderer::sprites::init(renderer::g_Headless ? renderer::headless::format() : renderer::swapchain::surface_format().format);
+    if (headless_options.Sprites > 0)
+        CreateSpriteBenchmark(headless_options.Sprites);
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -175,7 +384,8 @@ int main(int, char**)
     //ImGui::StyleColorsLight();
 
     // Setup Platform/Renderer backends
-    ImGui_ImplSDL3_InitForVulkan(renderer::window);
+    if (!renderer::g_Headless)
+        ImGui_ImplSDL3_InitForVulkan(renderer::window);
     ImGui_ImplVulkan_InitInfo init_info = {};
     init_info.Instance = renderer::vk_Instance;
     init_info.PhysicalDevice = renderer::g_PhysicalDevice;
@@ -184,14 +394,24 @@ int main(int, char**)
     init_info.Queue = renderer::g_Queue;
     init_info.PipelineCache = renderer::g_PipelineCache;
     init_info.DescriptorPool = renderer::imgui_DescriptorPool;
-    init_info.RenderPass = renderer::imgui::wd->RenderPass;
-    init_info.Subpass = 0;
+    // the pipeline is built against the target format instead of a render pass, it has to outlive ImGui_ImplVulkan_Init
+    static VkFormat imgui_color_format = renderer::g_Headless ? renderer::headless::format() : renderer::swapchain::surface_format().format;
+    init_info.UseDynamicRendering = true;
+    init_info.PipelineRenderingCreateInfo = {};
+    init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &imgui_color_format;
     init_info.MinImageCount = renderer::g_MinImageCount;
-    init_info.ImageCount = renderer::imgui::wd->ImageCount;
+    // ImGui rotates its vertex buffers over ImageCount frames, pacing never lets more than MAX_INFLIGHT_FRAMES be in flight
+    // no matter how many images the swapchain ends up with after a rebuild
+    init_info.ImageCount = std::max<uint32_t>(MAX_INFLIGHT_FRAMES, renderer::g_MinImageCount);
     init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
     init_info.Allocator = renderer::g_vk_Allocator;
     init_info.CheckVkResultFn = check_vk_result;
+    // the ImGui pipeline is the startup pipeline today, this is what a warm cache speeds up
+    const auto pipelines_start = std::chrono::steady_clock::now();
     ImGui_ImplVulkan_Init(&init_info);
+    renderer::pipeline_cache::record_startup(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - pipelines_start).count());
 
     // Load Fonts
     // - If no fonts are loaded, dear imgui will use the default font. You can also load multiple fonts and use ImGui::PushFont()/PopFont() to select them.
@@ -222,78 +442,169 @@ int main(int, char**)
     editor->log(love::editor::LogType::Debug, "Debugging started");
 
     int fr=0;
+    uint32_t headless_frame = 0;
+    auto frame_start = std::chrono::steady_clock::now();
+    const auto run_start = frame_start;
     // Main loop
     bool done = false;
+    love::profiler::set_thread_name("main");
     while (!done)
     {
-        // Poll and handle events (inputs, window resize, etc.)
-        // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
-        // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
-        // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
-        // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
+        love::profiler::frame_mark();
         {
-            ImGui_ImplSDL3_ProcessEvent(&event);
-            editor->check_events(&event);
-            if (event.type == SDL_EVENT_QUIT)
-                done = true;
-            if (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event.window.windowID == SDL_GetWindowID(renderer::window))
-                done = true;
-
+            LOVE_ZONE("Frame pacing");
+            renderer::pacing::begin_frame();
         }
-        if (SDL_GetWindowFlags(renderer::window) & SDL_WINDOW_MINIMIZED)
+        if (renderer::g_Headless)
         {
-            SDL_Delay(10);
-            continue;
+            // no events or resizes, frame times run from one frame start to the next
+            if (headless_frame == headless_options.Frames)
+                renderer::timeline::wait_idle(); // so the last frame's time includes its GPU work
+            const auto now = std::chrono::steady_clock::now();
+            const float frame_ms = std::chrono::duration<float, std::milli>(now - frame_start).count();
+            if (headless_frame > 0)
+                renderer::headless::record_frame(frame_ms);
+            frame_start = now;
+            if (headless_frame++ == headless_options.Frames)
+                break;
+            io.DisplaySize = ImVec2((float)renderer::headless::width(), (float)renderer::headless::height());
+            io.DeltaTime = headless_frame > 1 && frame_ms > 0.0f ? frame_ms / 1000.0f : 1.0f / 60.0f;
+        }
+        else
+        {
+            // Poll and handle events (inputs, window resize, etc.)
+            // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
+            // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
+            // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
+            // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
+            {
+                LOVE_ZONE("Poll events");
+                SDL_Event event;
+                while (SDL_PollEvent(&event))
+                {
+                    ImGui_ImplSDL3_ProcessEvent(&event);
+                    editor->check_events(&event);
+                    if (event.type == SDL_EVENT_QUIT)
+                        done = true;
+                    if (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event.window.windowID == SDL_GetWindowID(renderer::window))
+                        done = true;
+
+                }
+            }
+            if (SDL_GetWindowFlags(renderer::window) & SDL_WINDOW_MINIMIZED)
+            {
+                SDL_Delay(10);
+                continue;
+            }
         }
         advance_frame_and_execute_cleanups();
-
-        // Resize swap chain?
-        int fb_width, fb_height;
-        SDL_GetWindowSize(renderer::window, &fb_width, &fb_height);
-        if (fb_width > 0 && fb_height > 0 && (renderer::g_SwapChainRebuild || renderer::imgui::imgui_MainWindowData.Width != fb_width || renderer::imgui::imgui_MainWindowData.Height != fb_height))
+        renderer::streaming::pump();
+        renderer::pipeline_cache::update();
+        renderer::sprites::begin_frame();
+
+        // Resize swap chain? Frames in flight keep rendering into the old one, nothing waits for the device here
+        int fb_width = 0, fb_height = 0;
+        if (!renderer::g_Headless)
+            SDL_GetWindowSizeInPixels(renderer::window, &fb_width, &fb_height);
+        if (fb_width > 0 && fb_height > 0 && (renderer::g_SwapChainRebuild || renderer::swapchain::width() != (uint32_t)fb_width || renderer::swapchain::height() != (uint32_t)fb_height))
         {
             ImGui_ImplVulkan_SetMinImageCount(renderer::g_MinImageCount);
-            ImGui_ImplVulkanH_CreateOrResizeWindow(renderer::vk_Instance, renderer::g_PhysicalDevice, renderer::device, &renderer::imgui::imgui_MainWindowData, renderer::g_QueueFamily, renderer::g_vk_Allocator, fb_width, fb_height, renderer::g_MinImageCount);
-            renderer::imgui::imgui_MainWindowData.FrameIndex = 0;
+            renderer::swapchain::recreate((uint32_t)fb_width, (uint32_t)fb_height);
             renderer::g_SwapChainRebuild = false;
         }
 
+        if (g_SpriteBenchmark.Count > 0)
+        {
+            LOVE_ZONE("Submit sprites");
+            // headless runs animate on a fixed step so every run draws the same frames
+            const float time = renderer::g_Headless ? headless_frame / 60.0f
+                                                    : std::chrono::duration<float>(std::chrono::steady_clock::now() - run_start).count();
+            SubmitSpriteBenchmark(time, renderer::g_Headless ? renderer::headless::width() : renderer::swapchain::width(),
+                                  renderer::g_Headless ? renderer::headless::height() : renderer::swapchain::height());
+        }
+
         // Start the Dear ImGui frame
         ImGui_ImplVulkan_NewFrame();
-        ImGui_ImplSDL3_NewFrame();
+        if (!renderer::g_Headless)
+            ImGui_ImplSDL3_NewFrame();
         ImGui::NewFrame();
 
-        editor->draw(done);
+        {
+            LOVE_ZONE("Editor::draw");
+            editor->draw(done);
+        }
 
         // Rendering
-        ImGui::Render();
+        {
+            LOVE_ZONE("ImGui::Render");
+            ImGui::Render();
+        }
         ImDrawData* draw_data = ImGui::GetDrawData();
         const bool is_minimized = (draw_data->DisplaySize.x <= 0.0f || draw_data->DisplaySize.y <= 0.0f);
         if (!is_minimized)
         {
-            renderer::imgui::wd->ClearValue.color.float32[0] = clear_color.x * clear_color.w;
-            renderer::imgui::wd->ClearValue.color.float32[1] = clear_color.y * clear_color.w;
-            renderer::imgui::wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
-            renderer::imgui::wd->ClearValue.color.float32[3] = clear_color.w;
-            FrameRender(renderer::imgui::wd, draw_data);
-            FramePresent(renderer::imgui::wd);
+            VkClearValue clear_value = {};
+            clear_value.color.float32[0] = clear_color.x * clear_color.w;
+            clear_value.color.float32[1] = clear_color.y * clear_color.w;
+            clear_value.color.float32[2] = clear_color.z * clear_color.w;
+            clear_value.color.float32[3] = clear_color.w;
+            {
+                LOVE_ZONE("FrameRender");
+                FrameRender(clear_value, draw_data);
+            }
+            FramePresent();
+            renderer::pacing::end_frame(renderer::timeline::last_submitted());
         }
     }
 
     // Cleanup
     auto err = vkDeviceWaitIdle(renderer::device);
     check_vk_result(err);
+    delete editor;
+    editor = nullptr;
+    const uint32_t record_threads = renderer::parallel::thread_count();
+    renderer::parallel::shutdown();
+    renderer::streaming::shutdown();
+    renderer::cook::shutdown();
+    renderer::staging::shutdown();
+    renderer::linear::shutdown();
+    renderer::mips::shutdown();
+    renderer::gpu_profiler::shutdown();
+    if (g_SpriteBenchmark.Count > 0)
+    {
+        const renderer::sprites::SpriteStats sprite_stats = renderer::sprites::stats();
+        SDL_Log("[sprites] %u sprites in %u draws, sort %.3f ms, instance write and record %.3f ms over %u jobs on %u threads "
+                "(averaged over %u frames)", sprite_stats.sprites, sprite_stats.draws, sprite_stats.avg_sort_ms,
+                sprite_stats.avg_write_ms, sprite_stats.jobs, record_threads, sprite_stats.frames);
+    }
+    DestroySpriteBenchmark();
+    renderer::sprites::shutdown();
+    renderer::graph::shutdown();
+    shutdown_frame_resource_manager();
     ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplSDL3_Shutdown();
+    if (!renderer::g_Headless)
+        ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
 
+    int result = 0;
+    if (headless_options.TracePath && !love::profiler::write_chrome_trace(headless_options.TracePath))
+    {
+        SDL_Log("[profiler] Error: could not write %s", headless_options.TracePath);
+        result = 1;
+    }
+    if (renderer::g_Headless)
+    {
+        renderer::headless::log_stats();
+        if (headless_options.StatsPath && !renderer::headless::write_stats(headless_options.StatsPath))
+            result = 1;
+        renderer::headless::shutdown();
+    }
     renderer::CleanupVulkanWindow();
     renderer::CleanupVulkan();
 
-    SDL_DestroyWindow(renderer::window);
+    if (renderer::window)
+        SDL_DestroyWindow(renderer::window);
     SDL_Quit();
 
-    return 0;
+    return result;
 }
\ No newline at end of file